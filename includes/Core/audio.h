@@ -3,15 +3,22 @@
 
 #include "common.h"
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
 namespace Player {
 struct Spec;
 struct ResampleAudioSpec;
-
-struct AudioBuffer {
-  size_t len = 0;
-  size_t pullSize = 0;
-  Byte *data = nullptr;
-};
+struct AudioStats;
+class Mixer;
+class AudioSource;
+class RingSource;
+class MappedSource;
+class Playlist;
+class FileReader;
 
 class Audio {
 public:
@@ -46,8 +53,23 @@ public:
 
   void stop();
 
+  [[nodiscard]] bool playing() const { return playing_; }
+
+  // jump to `ms` into what is playing: PCM and WAV land on the exact frame, ADTS AAC restarts at
+  // the nearest indexed frame and drops samples up to `ms`
+  void seek(int64_t ms);
+
   void playWAV();
 
+  // decode an ADTS stream straight into the mixer, no intermediate PCM file
+  void playAAC();
+
+  // queued files (.wav or raw PCM in this instance's spec) play gaplessly on one channel, each
+  // one is opened and buffered while the previous one is still playing
+  void enqueue(const std::string &name);
+  void playQueue();
+  void clearQueue();
+
   [[maybe_unused]] void setSampleRate(int sampleRate) const;
   [[nodiscard]] int sampleRate() const;
 
@@ -60,18 +82,77 @@ public:
   [[maybe_unused]] void setSamples(int samples) const;
   [[nodiscard]] int samples() const;
 
+  [[maybe_unused]] void setPeriods(int periods) const;
+  [[nodiscard]] int periods() const;
+
   [[nodiscard]] Spec *spec() const;
 
+  // several Audio instances can share one Mixer to play concurrently
+  void setMixer(Mixer *mixer);
+  Mixer *mixer();
+
+  void setGain(float gain);
+  [[nodiscard]] float gain() const;
+
+  // callback timing, underruns and buffer fill of the mixer this instance plays on
+  const AudioStats &stats();
+  void dumpStats();
+
   static void decodeAAC();
 
-  static void decodeAAC(const std::string &name, Player::ResampleAudioSpec &spec);
+  static bool decodeAAC(const std::string &name, Player::ResampleAudioSpec &spec);
+
+  // any container/codec avformat can open, written as interleaved PCM to spec.filename
+  static void decodeFile(const std::string &name, Player::ResampleAudioSpec &spec);
+
+  // return false from the handler to stop decoding
+  using FrameHandler = std::function<bool(AVCodecContext *, AVFrame *)>;
+
+  // `offset` must be the start of an ADTS frame
+  static bool decodeAAC(const std::string &name, const FrameHandler &onFrame, size_t offset = 0);
+
+  // 0 for formats SDL can't play
+  static SDL_AudioFormat getSDLFormat(AVSampleFormat fmt);
 
 private:
   void run();
 
   void runWAV();
 
-  bool parseWAV(SDL_AudioSpec &spec, std::ifstream &input) const;
+  void runAAC();
+
+  struct Track;
+
+  void runQueue();
+
+  bool dequeue(std::string &name);
+
+  bool load(const std::string &name, Track &track) const;
+
+  static void pump(Track &track);
+
+  void start(const SDL_AudioSpec &spec, FileReader &input, size_t offset, int period);
+
+  void feed(FileReader &input, const std::shared_ptr<RingSource> &source, int period);
+
+  bool push(const std::shared_ptr<RingSource> &source, const Byte *data, size_t len,
+            size_t prefill, bool &attached);
+
+  // at the end of the input: attaches if that hasn't happened yet, then waits until the tail is
+  // played out or a seek comes in; true for the seek
+  bool awaitSeek(const std::shared_ptr<RingSource> &source, bool &attached);
+
+  void drain(const std::shared_ptr<RingSource> &source, bool &attached);
+
+  void playMapped(const std::shared_ptr<MappedSource> &source, int period);
+
+  bool attach(const std::shared_ptr<AudioSource> &source);
+
+  void detach();
+
+  static size_t byteOffset(const SDL_AudioSpec &spec, int64_t ms);
+
+  bool parseWAV(const std::string &name, SDL_AudioSpec &spec, FileReader &input) const;
 
   [[nodiscard]] int bufferSize();
 
@@ -81,7 +162,8 @@ private:
 
   void initWithFormatContext(AVFormatContext *ctx);
 
-  static int decode(AVCodecContext *ctx, AVPacket *pkt, AVFrame *frame, std::ofstream &output);
+  static int decode(AVCodecContext *ctx, AVPacket *pkt, AVFrame *frame,
+                    const FrameHandler &onFrame);
 
 private:
   std::string filename_;
@@ -90,12 +172,29 @@ private:
 
   std::atomic<bool> playing_{false};
 
+  Mixer *mixer_ = nullptr;
+
+  bool ownsMixer_ = false;
+
+  float gain_ = 1.0f;
+
+  std::atomic<int> channel_{0};
+
+  // pending seek in ms, -1 for none
+  std::atomic<int64_t> seekTarget_{-1};
+
+  std::mutex queueMutex_;
+
+  std::deque<std::string> queue_;
+
   static SDL_AudioFormat getSDLFormat(uint16_t audioFormat, uint16_t bitsPerSample, bool &success);
 
 #ifdef _WIN32
   AudioFormat format_ = FormatS16;
 #elif __APPLE__
   AudioFormat format_ = FormatF32LSB;
+#elif __linux__
+  AudioFormat format_ = FormatS16;
 #endif
 };
 
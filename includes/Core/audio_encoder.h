@@ -0,0 +1,65 @@
+#ifndef PLAYER_AUDIO_ENCODER_H
+#define PLAYER_AUDIO_ENCODER_H
+
+#include "common.h"
+
+namespace Player {
+class Muxer;
+
+// Encodes PCM packets read off a capture device into an AAC stream of a Muxer. One persistent
+// SwrContext converts straight into the encoder's format and an AVAudioFifo gathers whole
+// frame_size frames. libfdk_aac is preferred, the native encoder is the fallback.
+class AudioEncoder {
+public:
+  AudioEncoder() = default;
+
+  ~AudioEncoder();
+
+  AudioEncoder(const AudioEncoder &) = delete;
+
+  AudioEncoder &operator=(const AudioEncoder &) = delete;
+
+  // `input` describes the device's PCM, its sample format is `inputFmt`
+  bool open(Muxer &muxer, const AVCodecParameters *input, AVSampleFormat inputFmt,
+            int sampleRate = 44100);
+
+  // one PCM packet as read from the device; the first packet's pts, in microseconds, places the
+  // stream on the recording's clock, after that samples are counted
+  bool encode(const AVPacket *pkt);
+
+  // drains the resampler and the encoder, the muxer stays open
+  void close();
+
+  [[nodiscard]] const char *name() const;
+
+private:
+  // feeds the encoder whole frame_size frames, or what is left when flushing
+  bool drain(bool flush);
+
+  bool send(AVFrame *frame);
+
+private:
+  Muxer *muxer_ = nullptr;
+
+  int stream_ = -1;
+
+  AVCodecContext *ctx_ = nullptr;
+
+  SwrContext *swr_ = nullptr;
+
+  AVAudioFifo *fifo_ = nullptr;
+
+  AVFrame *frame_ = nullptr;
+
+  Byte **converted_ = nullptr;
+
+  int convertedSize_ = 0;
+
+  int inputFrameSize_ = 0;
+
+  int64_t pts_ = AV_NOPTS_VALUE;
+};
+
+} // namespace Player
+
+#endif // PLAYER_AUDIO_ENCODER_H
@@ -0,0 +1,35 @@
+#ifndef PLAYER_AUDIO_PIPELINE_H
+#define PLAYER_AUDIO_PIPELINE_H
+
+#include "Utils/pipeline.h"
+#include "common.h"
+
+namespace Player {
+class FileWriter;
+class MemoryPipe;
+class PacketQueue;
+struct ResampleAudioSpec;
+
+// Resample -> AAC encode -> decode with every stage on a thread of its own. Resampled PCM goes to
+// the encoder as packets, the ADTS stream to the decoder through an in-memory AVIOContext, so the
+// only file written by default is the decoded output.
+class AudioPipeline {
+public:
+  // `resampled` is what the encoder gets, `decoded` receives the output's format; with `keep`
+  // the intermediates also land in resampled.filename and the .aac next to it
+  static bool run(const ResampleAudioSpec &input, const ResampleAudioSpec &resampled,
+                  ResampleAudioSpec &decoded, bool keep = false);
+
+private:
+  static bool resample(Pipeline::Stage &stage, const ResampleAudioSpec &input,
+                       const ResampleAudioSpec &output, FileWriter *copy, PacketQueue &pcm);
+
+  static bool encode(Pipeline::Stage &stage, const ResampleAudioSpec &spec, PacketQueue &pcm,
+                     MemoryPipe &aac);
+
+  static bool decode(Pipeline::Stage &stage, MemoryPipe &aac, ResampleAudioSpec &spec);
+};
+
+} // namespace Player
+
+#endif // PLAYER_AUDIO_PIPELINE_H
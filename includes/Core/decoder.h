@@ -0,0 +1,55 @@
+#ifndef PLAYER_DECODER_H
+#define PLAYER_DECODER_H
+
+#include "common.h"
+
+#include <atomic>
+#include <thread>
+
+namespace Player {
+class PacketQueue;
+class FrameQueue;
+
+// Decodes one stream on its own thread, from a PacketQueue filled by the Demuxer into a
+// FrameQueue. The codec's own frame/slice threading is enabled on top of that.
+class Decoder {
+public:
+  Decoder() = default;
+
+  ~Decoder();
+
+  Decoder(const Decoder &) = delete;
+
+  Decoder &operator=(const Decoder &) = delete;
+
+  // `threads` 0 lets the codec pick one per core
+  bool open(const AVStream *stream, int threads = 0);
+
+  void close();
+
+  bool start(PacketQueue *packets, FrameQueue *frames);
+
+  void stop();
+
+  AVCodecContext *context() { return ctx_; }
+
+private:
+  void run();
+
+  bool receive();
+
+private:
+  AVCodecContext *ctx_ = nullptr;
+
+  PacketQueue *packets_ = nullptr;
+
+  FrameQueue *frames_ = nullptr;
+
+  std::thread thread_;
+
+  std::atomic<bool> running_{false};
+};
+
+} // namespace Player
+
+#endif // PLAYER_DECODER_H
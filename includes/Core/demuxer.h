@@ -0,0 +1,69 @@
+#ifndef PLAYER_DEMUXER_H
+#define PLAYER_DEMUXER_H
+
+#include "Utils/file_avio.h"
+#include "common.h"
+
+#include <atomic>
+#include <map>
+#include <thread>
+
+namespace Player {
+class PacketQueue;
+
+// Reads any container avformat understands on its own thread and routes the packets of the
+// streams somebody asked for into their queues. Packets of other streams are dropped. Local files
+// are read through FileAVIO, anything else avformat opens itself.
+class Demuxer {
+public:
+  Demuxer() = default;
+
+  ~Demuxer();
+
+  Demuxer(const Demuxer &) = delete;
+
+  Demuxer &operator=(const Demuxer &) = delete;
+
+  bool open(const std::string &filename);
+
+  // reads through a custom AVIOContext the caller keeps, `format` skips probing for it
+  bool open(AVIOContext *pb, const char *format = nullptr);
+
+  void close();
+
+  // -1 when the file has no such stream
+  int bestStream(AVMediaType type) const;
+
+  AVStream *stream(int index) const;
+
+  void route(int index, PacketQueue *queue);
+
+  bool start();
+
+  void stop();
+
+  AVFormatContext *context() { return ctx_; }
+
+private:
+  // `url` only hints the format when `pb` is set
+  bool openInput(const char *url, AVIOContext *pb, const char *format);
+
+  bool findStreamInfo();
+
+  void run();
+
+private:
+  AVFormatContext *ctx_ = nullptr;
+
+  std::map<int, PacketQueue *> queues_;
+
+  std::thread thread_;
+
+  std::atomic<bool> running_{false};
+
+  FileAVIO file_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_DEMUXER_H
@@ -5,6 +5,8 @@
 
 namespace Player {
 class Window;
+class TexturePool;
+class Scaler;
 
 class Image {
 public:
@@ -12,7 +14,9 @@ public:
 
   ~Image();
 
-  explicit Image(SDL_Renderer *renderer);
+  // with a `pool` the texture is taken from it and handed back instead of destroyed; with a
+  // `scaler` raw pictures larger than the window are shrunk to fit before upload
+  explicit Image(SDL_Renderer *renderer, TexturePool *pool = nullptr, Scaler *scaler = nullptr);
 
   void load(const std::string &filename);
 
@@ -42,6 +46,10 @@ public:
 private:
   void deinit();
 
+  bool acquire(uint32_t format, int width, int height, int access);
+
+  bool shrink(AVBufferRef *buffer, uint32_t format, int width, int height);
+
 private:
   SDL_Renderer *renderer_ = nullptr;
 
@@ -50,6 +58,10 @@ private:
   int height_ = 0;
 
   SDL_Texture *texture_ = nullptr;
+
+  TexturePool *pool_ = nullptr;
+
+  Scaler *scaler_ = nullptr;
 };
 } // namespace Player
 
@@ -0,0 +1,136 @@
+#ifndef PLAYER_MEDIA_PLAYER_H
+#define PLAYER_MEDIA_PLAYER_H
+
+#include "Core/decoder.h"
+#include "Core/demuxer.h"
+#include "Utils/packet_queue.h"
+#include "Utils/scaler.h"
+#include "Utils/stats.h"
+#include "common.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace Player {
+class Mixer;
+class RingSource;
+
+// Plays a media file: the Demuxer reads on its own thread, audio and video are decoded on one
+// thread each into bounded frame queues, a feeder thread moves the audio into the Mixer and the
+// video is presented from the UI thread, scheduled against the audio clock. Video frames that are
+// already behind the clock are dropped rather than shown late.
+class MediaPlayer {
+public:
+  MediaPlayer(SDL_Renderer *renderer, Mixer *mixer) : renderer_(renderer), mixer_(mixer) {}
+
+  ~MediaPlayer();
+
+  MediaPlayer(const MediaPlayer &) = delete;
+
+  MediaPlayer &operator=(const MediaPlayer &) = delete;
+
+  bool open(const std::string &filename);
+
+  void close();
+
+  // presents the frame that is due; call it from the thread owning the renderer. Returns the
+  // milliseconds until it wants to run again, -1 once playback is over
+  int update();
+
+  [[nodiscard]] bool playing() const { return playing_; }
+
+  [[nodiscard]] const PlaybackStats &stats() const { return stats_; }
+
+private:
+  bool openAudio();
+
+  bool openVideo();
+
+  void feed();
+
+  bool push(const Byte *data, size_t len, int64_t pts);
+
+  // microseconds on the stream timeline, AV_NOPTS_VALUE while nothing sets it yet
+  int64_t clock();
+
+  bool present(AVFrame *frame);
+
+  void render();
+
+  [[nodiscard]] int64_t timestamp(const AVFrame *frame, const AVStream *stream) const;
+
+  SDL_Renderer *renderer() { return renderer_; }
+
+private:
+  SDL_Renderer *renderer_;
+
+  Mixer *mixer_;
+
+  std::atomic<bool> playing_{false};
+
+  Demuxer demuxer_;
+
+  int audioIndex_ = -1;
+
+  int videoIndex_ = -1;
+
+  Decoder audioDecoder_;
+
+  Decoder videoDecoder_;
+
+  PacketQueue audioPackets_{256};
+
+  PacketQueue videoPackets_{64};
+
+  FrameQueue audioFrames_{32};
+
+  // a few decoded frames of slack, more only costs memory at 1080p
+  FrameQueue videoFrames_{8};
+
+  std::thread feeder_;
+
+  std::shared_ptr<RingSource> source_;
+
+  // set once source_ is in the mixer, source_ and byteRate_ are only read by others after that
+  std::atomic<int> channel_{0};
+
+  // bytes per second of what goes into the ring
+  int64_t byteRate_ = 0;
+
+  // stream time right after the last byte written to the ring
+  std::atomic<int64_t> audioEnd_{AV_NOPTS_VALUE};
+
+  // stream time at the ring's first byte, moves only where the timestamps jump
+  std::atomic<int64_t> audioOrigin_{0};
+
+  std::atomic<bool> audioDone_{false};
+
+  // clock() minus the wall clock, carried on once the audio has ended or when there is none
+  int64_t offset_ = AV_NOPTS_VALUE;
+
+  int64_t frameDuration_ = 0;
+
+  // the next frame to present, held until the clock reaches it
+  AVFrame *pending_ = nullptr;
+
+  int64_t pendingPts_ = 0;
+
+  SDL_Texture *texture_ = nullptr;
+
+  int width_ = 0;
+
+  int height_ = 0;
+
+  // frames larger than the window are shrunk to it before upload, the rest only converted to
+  // yuv420p when they aren't already
+  Scaler scaler_;
+
+  AVFrame *converted_ = nullptr;
+
+  PlaybackStats stats_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_MEDIA_PLAYER_H
@@ -0,0 +1,134 @@
+#ifndef PLAYER_MIXER_H
+#define PLAYER_MIXER_H
+
+#include "Utils/stats.h"
+#include "common.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Player {
+class AudioSource;
+class AudioSink;
+
+// Owns a single audio sink and mixes every attached source into it in one callback pass. The
+// sink is opened lazily with the first source's spec; sources in another format are converted
+// through an SDL_AudioStream. Sources may be added and removed from any thread.
+class Mixer {
+public:
+  struct Period {
+    // av_gettime_relative() when the callback started, 0 before the first one
+    int64_t start = 0;
+    // microseconds of audio it handed to the sink
+    int64_t duration = 0;
+  };
+
+  // plays on the default sound card
+  Mixer();
+
+  // plays into `sink`, which has to outlive the mixer
+  explicit Mixer(AudioSink *sink);
+
+  ~Mixer();
+
+  Mixer(const Mixer &) = delete;
+
+  Mixer &operator=(const Mixer &) = delete;
+
+  bool open(const SDL_AudioSpec &desired);
+
+  void close();
+
+  [[nodiscard]] bool isOpen() const { return open_; }
+
+  // returns a channel id, 0 on failure
+  int add(const std::shared_ptr<AudioSource> &source, float gain = 1.0f);
+
+  // once this returns the callback no longer touches the source
+  void remove(int id);
+
+  void setGain(int id, float gain);
+
+  // runs `move` with the callback held off and drops what was already converted for the channel,
+  // so a source can be repositioned in place
+  void reposition(int id, const std::function<void()> &move);
+
+  // the last callback. Sources are only pulled inside callbacks, so what `sample` reads from one is
+  // in step with the returned period; it runs again when a callback lands in between
+  Period period(const std::function<void()> &sample) const;
+
+  [[nodiscard]] const SDL_AudioSpec &spec() const { return spec_; }
+
+  [[nodiscard]] const AudioStats &stats() const { return stats_; }
+
+  void resetStats() { stats_.reset(); }
+
+private:
+  struct Channel {
+    int id = 0;
+    std::shared_ptr<AudioSource> source;
+    float gain = 1.0f;
+    // gain the last period ended with, changes are ramped from it
+    float applied = 1.0f;
+    // set when the source has to be converted to the device format
+    SDL_AudioStream *stream = nullptr;
+    int frameSize = 0;
+  };
+
+  static void callback(void *userdata, Byte *stream, int len);
+
+  // with control_ held
+  bool openDevice(const SDL_AudioSpec &desired);
+
+  // returns the bytes the sources filled, the rest of the period is underrun silence
+  int mix(Byte *stream, int len);
+
+  int fill(Channel &channel, Byte *data, int len);
+
+  void lock();
+
+  void unlock();
+
+private:
+  // set when the mixer opened the default sound card itself
+  std::unique_ptr<AudioSink> ownSink_;
+
+  AudioSink *sink_;
+
+  // serializes opening, closing and attaching against each other, the callback never takes it
+  std::mutex control_;
+
+  std::atomic<bool> open_{false};
+
+  SDL_AudioSpec spec_{};
+
+  // only touched with the device locked
+  std::vector<Channel> channels_;
+
+  int frameSize_ = 0;
+
+  std::vector<Byte> scratch_;
+
+  std::vector<Byte> convert_;
+
+  int nextId_ = 1;
+
+  AudioStats stats_;
+
+  std::chrono::steady_clock::time_point lastCallback_{};
+
+  // odd while a callback runs, guards the period below
+  std::atomic<uint64_t> sequence_{0};
+
+  std::atomic<int64_t> periodStart_{0};
+
+  std::atomic<int64_t> periodDuration_{0};
+};
+
+} // namespace Player
+
+#endif // PLAYER_MIXER_H
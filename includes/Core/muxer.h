@@ -0,0 +1,74 @@
+#ifndef PLAYER_MUXER_H
+#define PLAYER_MUXER_H
+
+#include "Utils/file_avio.h"
+#include "Utils/packet_queue.h"
+#include "common.h"
+
+#include <thread>
+#include <vector>
+
+namespace Player {
+
+// Interleaves the packets of one or more encoders into a file on a thread of its own. The
+// container comes from the filename; .mp4/.mov are written fragmented so a crash mid-recording
+// still leaves a playable file. Files go through FileAVIO, preallocated for a few seconds of the
+// streams' bit rate.
+class Muxer {
+public:
+  Muxer() = default;
+
+  ~Muxer();
+
+  Muxer(const Muxer &) = delete;
+
+  Muxer &operator=(const Muxer &) = delete;
+
+  bool open(const std::string &filename);
+
+  // writes through a custom AVIOContext the caller keeps, in the container named by `format`
+  bool open(AVIOContext *pb, const char *format);
+
+  // encoders must set AV_CODEC_FLAG_GLOBAL_HEADER when this is true
+  [[nodiscard]] bool globalHeader() const;
+
+  // stream for an opened encoder, its packets are expected in ctx->time_base; -1 on failure
+  int addStream(const AVCodecContext *ctx);
+
+  // writes the header once every stream is added and starts the muxing thread
+  bool start();
+
+  // takes ownership of `pkt`, its stream_index must come from addStream()
+  bool write(AVPacket *pkt);
+
+  // drops what is still queued and refuses more packets, close() then finishes the file with
+  // what was muxed so far
+  void abort();
+
+  // muxes what is queued, then finishes the file
+  void close();
+
+private:
+  void run();
+
+private:
+  std::string filename_;
+
+  AVFormatContext *ctx_ = nullptr;
+
+  std::vector<AVRational> timeBases_;
+
+  PacketQueue queue_{256};
+
+  std::thread thread_;
+
+  bool headerWritten_ = false;
+
+  bool customIO_ = false;
+
+  FileAVIO file_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_MUXER_H
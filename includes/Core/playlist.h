@@ -0,0 +1,73 @@
+#ifndef PLAYER_PLAYLIST_H
+#define PLAYER_PLAYLIST_H
+
+#include "Core/source.h"
+#include "Utils/spsc_queue.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Player {
+
+// Plays its items back to back on one mixer channel, switching on a sample boundary. Items whose
+// format differs from spec() are converted, so the channel never has to be reopened. Items are
+// handed to the audio thread and back through lock-free queues, one loader thread appends and
+// collects.
+class Playlist : public AudioSource {
+public:
+  explicit Playlist(const SDL_AudioSpec &spec);
+
+  ~Playlist() override;
+
+  // false when too many items are still queued or waiting to be collected
+  bool append(const std::shared_ptr<AudioSource> &source);
+
+  int pull(Byte *stream, int len) override;
+
+  // nothing left to play right now, a later append resumes playback
+  [[nodiscard]] bool finished() const override;
+
+  // the playing item's, on the audio thread
+  [[nodiscard]] int fill() const override;
+
+  // items appended and not played out yet
+  [[nodiscard]] size_t size() const;
+
+  // frees played items, call it off the audio thread
+  void collect();
+
+private:
+  struct Item {
+    std::shared_ptr<AudioSource> source;
+    SDL_AudioStream *stream = nullptr;
+    int frameSize = 0;
+    // source samples on their way into the stream
+    std::vector<Byte> convert;
+  };
+
+  int read(Item &item, Byte *stream, int len);
+
+  static void release(Item *item);
+
+private:
+  int frameSize_;
+
+  // appended -> audio thread
+  SpscQueue<Item *> incoming_;
+
+  // audio thread -> collect()
+  SpscQueue<Item *> retired_;
+
+  // only touched on the audio thread
+  Item *current_ = nullptr;
+
+  std::atomic<size_t> queued_{0};
+
+  // appended and not collected yet, bounds both queues
+  std::atomic<size_t> live_{0};
+};
+
+} // namespace Player
+
+#endif // PLAYER_PLAYLIST_H
@@ -0,0 +1,113 @@
+#ifndef PLAYER_RAW_VIDEO_H
+#define PLAYER_RAW_VIDEO_H
+
+#include "Utils/file_io.h"
+#include "Utils/mapped_file.h"
+#include "Utils/stats.h"
+#include "common.h"
+
+#include <vector>
+
+namespace Player {
+
+// Plays a headerless YUV file frame by frame into a streaming texture. Each frame is copied
+// straight from the mapping (or the read-ahead buffer) into the locked texture, and frames whose
+// slot has already passed are skipped instead of slowing the clip down.
+class RawVideo {
+public:
+  explicit RawVideo(SDL_Renderer *renderer) : renderer_(renderer) {}
+
+  ~RawVideo();
+
+  RawVideo(const RawVideo &) = delete;
+
+  RawVideo &operator=(const RawVideo &) = delete;
+
+  bool open(const std::string &filename, int width, int height, double frameRate = 30,
+            uint32_t format = SDL_PIXELFORMAT_IYUV);
+
+  // a capture the Recorder wrote, in the size, rate and format it stored next to it
+  bool open(const std::string &filename);
+
+  // stores what open(filename) needs next to a raw capture, as <name>.info
+  static bool describe(const std::string &filename, int width, int height, AVRational frameRate,
+                       AVPixelFormat format);
+
+  void close();
+
+  // shows the frame that is due, returns the milliseconds until the next one or -1 once the
+  // clip is over
+  int update();
+
+  [[nodiscard]] bool playing() const { return frames_ > 0; }
+
+  [[nodiscard]] const VideoStats &stats() const { return stats_; }
+
+  // bytes of one frame in the file, 0 for a format this can't play
+  static size_t frameSize(uint32_t format, int width, int height);
+
+  // bytes of one row of the first plane
+  static int pitch(uint32_t format, int width);
+
+private:
+  struct Plane {
+    // bytes per row in the file
+    int pitch = 0;
+    int rows = 0;
+  };
+
+  static std::string sidecar(const std::string &filename);
+
+  // SDL_PIXELFORMAT_UNKNOWN for layouts planes() doesn't know
+  static uint32_t sdlFormat(AVPixelFormat format);
+
+  // planes in the order they follow each other, in the file and in the locked texture
+  static int planes(uint32_t format, int width, int height, Plane *planes);
+
+  SDL_Renderer *renderer() { return renderer_; }
+
+  bool upload(int64_t index);
+
+  void render();
+
+  [[nodiscard]] int64_t slot(int64_t index) const;
+
+private:
+  SDL_Renderer *renderer_;
+
+  SDL_Texture *texture_ = nullptr;
+
+  MappedFile map_;
+
+  // when the file can't be mapped
+  FileReader input_;
+
+  std::vector<Byte> scratch_;
+
+  uint32_t format_ = SDL_PIXELFORMAT_IYUV;
+
+  int width_ = 0;
+
+  int height_ = 0;
+
+  Plane planes_[3];
+
+  int planeCount_ = 0;
+
+  size_t frameSize_ = 0;
+
+  int64_t frames_ = 0;
+
+  // the next frame to go up
+  int64_t next_ = 0;
+
+  double frameRate_ = 30;
+
+  int64_t start_ = 0;
+
+  VideoStats stats_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_RAW_VIDEO_H
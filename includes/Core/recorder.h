@@ -1,8 +1,15 @@
 #ifndef PLAYER_RECORDER_H
 #define PLAYER_RECORDER_H
 
+#include "Utils/capture_clock.h"
+#include "Utils/frame_decimator.h"
+#include "Utils/packet_writer.h"
 #include "common.h"
 
+#include <functional>
+#include <optional>
+#include <vector>
+
 namespace Player {
 struct Header;
 struct ResampleAudioSpec;
@@ -15,7 +22,9 @@ public:
     FmtFlt = AV_SAMPLE_FMT_FLT,
   };
 
-  Recorder() = default;
+  // the backends come from PLAYER_AUDIO_BACKEND/PLAYER_AUDIO_DEVICE and
+  // PLAYER_VIDEO_BACKEND/PLAYER_VIDEO_DEVICE when set, the platform default otherwise
+  Recorder();
 
   [[maybe_unused]] explicit Recorder(const std::string &filename);
 
@@ -23,12 +32,28 @@ public:
 
   [[maybe_unused]] void recordAudio();
 
+  // raw frames when the filename ends in .yuv, compressed into its container otherwise
   void recordVideo();
 
+  // empty picks the first of libx264, mpeg4 and ffv1 that is available
+  void setVideoEncoder(const std::string &name);
+
   void recordWAV();
 
+  // capture, resample and encode in one pass, only the ADTS stream hits the disk
+  void recordAAC();
+
+  // camera and microphone into one file, .mkv or fragmented .mp4, the streams timestamped
+  // against a shared clock
+  void recordAV();
+
   void stop();
 
+  // what capture does when the disk writer falls behind, and how many packets it may queue
+  // (0 keeps the per-recording default); unset, audio and decimated video block and raw video
+  // drops the oldest packet
+  void setOverflow(Overflow overflow, size_t capacity = 0);
+
   void setFilename(const std::string &filename);
 
   [[nodiscard]] std::string filename() const;
@@ -40,6 +65,10 @@ public:
 
   void resample() const;
 
+  // the resample -> pcm2AAC -> decodeAAC chain in memory with the stages running concurrently;
+  // `keep` also writes the intermediate files
+  void pipeline(bool keep = false) const;
+
   static void resample(const std::string &inputName, int inputSampleRate, AVSampleFormat inputFmt,
                        AVChannelLayout inputChLayout, const std::string &outputName,
                        int outputSampleRate, AVSampleFormat outputFmt,
@@ -47,11 +76,36 @@ public:
 
   static void resample(ResampleAudioSpec &input, ResampleAudioSpec &output);
 
-  static void pcm2AAC(ResampleAudioSpec &spec, std::string aacFilename = "");
+  // resamples chunks of the input concurrently (0 threads means one per core), each chunk sees
+  // enough of its neighbours to cover the filter, however far it is stretched by decimating. The
+  // chunk borders fall on whole output samples, so the result matches resample() sample for
+  // sample with the default undithered filter; allow 1 LSB when dither is configured.
+  static bool resampleParallel(const ResampleAudioSpec &input, const ResampleAudioSpec &output,
+                               int threads = 0);
+
+  // each chunk's output, in order, while the ones after it are still being resampled; false
+  // from the handler stops the rest
+  using ChunkHandler = std::function<bool(const Byte *data, size_t len)>;
+
+  static bool resampleParallel(const ResampleAudioSpec &input, const ResampleAudioSpec &output,
+                               const ChunkHandler &onChunk, int threads = 0);
+
+  // ADTS through AudioEncoder, libfdk_aac when it is built in and the native encoder otherwise
+  static bool pcm2AAC(ResampleAudioSpec &spec, std::string aacFilename = "");
 
   static void pcm2AAC();
 
-  bool openDevice(const char *device, AVDictionary **opts = nullptr);
+  // avformat input device and device name to capture from, e.g. ("alsa", "hw:0"),
+  // ("pulse", "default"), ("v4l2", "/dev/video1") or ("lavfi", "sine=frequency=440") for a
+  // synthetic source; an empty name picks the backend's default
+  void setAudioDevice(const std::string &backend, const std::string &name = "");
+  void setVideoDevice(const std::string &backend, const std::string &name = "");
+
+  // opens the configured device for `type`, video gets the cheapest pixel format it offers
+  bool openDevice(AVMediaType type, AVDictionary **opts = nullptr);
+
+  bool openDevice(const char *device, AVDictionary **opts = nullptr,
+                  const char *backend = FMT_NAME);
 
   void closeDevice();
 
@@ -60,11 +114,33 @@ private:
 
   void writeYUV();
 
+  void writeVideo();
+
   void writeWAV();
 
-  static bool checkSampleFmt(const AVCodec *codec, AVSampleFormat fmt);
+  void writeAAC();
 
-  static int encode(AVCodecContext *ctx, AVFrame *frame, AVPacket *pkt, std::ofstream &output);
+  void writeAV();
+
+  // reads `input` on this thread until stopped, `write` runs on a writer thread; a `decimator`
+  // thins out video before it is queued, a `clock` restamps packets in microseconds. Only pass a
+  // decimator when the packets keep their timestamps to the output, raw files would run fast.
+  // False when the device failed rather than being stopped
+  bool capture(AVFormatContext *input, const PacketWriter::Write &write, size_t capacity,
+               FrameDecimator *decimator = nullptr, CaptureClock *clock = nullptr);
+
+  struct Device {
+    std::string backend;
+    std::string name;
+  };
+
+  static std::string defaultName(const std::string &backend, AVMediaType type);
+
+  bool negotiate(const Device &device, AVDictionary **opts);
+
+  static bool resampleChunk(const ResampleAudioSpec &input, const ResampleAudioSpec &output,
+                            int64_t begin, int64_t end, int64_t total, int64_t overlap,
+                            std::vector<Byte> &result);
 
 private:
   std::string filename_;
@@ -73,10 +149,22 @@ private:
 
   AVFormatContext *ctx_ = nullptr;
 
+  Device audioDevice_;
+
+  Device videoDevice_;
+
+  std::optional<Overflow> overflow_;
+
+  size_t queueCapacity_ = 0;
+
+  std::string videoEncoder_;
+
 #ifdef _WIN32
   AudioFmt fmt_ = FmtS16;
 #elif __APPLE__
   AudioFmt fmt_ = FmtFlt;
+#elif __linux__
+  AudioFmt fmt_ = FmtS16;
 #endif
 };
 
@@ -0,0 +1,127 @@
+#ifndef PLAYER_SINK_H
+#define PLAYER_SINK_H
+
+#include "Utils/file_io.h"
+#include "common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Player {
+
+// Where the Mixer's output goes. The sink drives desired.callback with desired.userdata, lock()
+// keeps the callback from running.
+class AudioSink {
+public:
+  virtual ~AudioSink() = default;
+
+  virtual bool open(const SDL_AudioSpec &desired, SDL_AudioSpec &obtained) = 0;
+
+  virtual void close() = 0;
+
+  virtual void pause(bool paused) = 0;
+
+  virtual void lock() = 0;
+
+  virtual void unlock() = 0;
+
+  // called by the callback: only the first `len` bytes of the period came from the sources, the
+  // rest is underrun silence
+  virtual void filled(int len) {}
+};
+
+// The default sound card.
+class DeviceSink : public AudioSink {
+public:
+  ~DeviceSink() override;
+
+  bool open(const SDL_AudioSpec &desired, SDL_AudioSpec &obtained) override;
+
+  void close() override;
+
+  void pause(bool paused) override;
+
+  void lock() override;
+
+  void unlock() override;
+
+private:
+  SDL_AudioDeviceID device_ = 0;
+};
+
+// No hardware: a thread of its own calls the callback, as fast as possible or paced like a real
+// device. Lets the whole playback pipeline run on headless machines. Running fast it waits for the
+// sources instead of writing underrun silence, so the output is exactly what they produced.
+class NullSink : public AudioSink {
+public:
+  explicit NullSink(bool realtime = false) : realtime_(realtime) {}
+
+  ~NullSink() override;
+
+  bool open(const SDL_AudioSpec &desired, SDL_AudioSpec &obtained) override;
+
+  void close() override;
+
+  void pause(bool paused) override;
+
+  void lock() override;
+
+  void unlock() override;
+
+  void filled(int len) override { filled_ = len; }
+
+  // seconds of audio the sources delivered, underrun silence not included
+  [[nodiscard]] double played() const;
+
+protected:
+  // every period after the callback filled it
+  virtual void write(const Byte *, int) {}
+
+private:
+  void run();
+
+private:
+  bool realtime_;
+
+  SDL_AudioSpec spec_{};
+
+  std::vector<Byte> buffer_;
+
+  // of the period being mixed, only touched on the sink's thread
+  int filled_ = 0;
+
+  std::atomic<int64_t> played_{0};
+
+  std::thread thread_;
+
+  std::atomic<bool> running_{false};
+
+  bool paused_ = true;
+
+  std::mutex mutex_;
+
+  std::mutex pauseMutex_;
+
+  std::condition_variable pauseCond_;
+};
+
+// A NullSink that also dumps the mixed output as raw PCM.
+class FileSink : public NullSink {
+public:
+  explicit FileSink(const std::string &filename, bool realtime = false);
+
+  ~FileSink() override;
+
+protected:
+  void write(const Byte *data, int len) override;
+
+private:
+  FileWriter output_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_SINK_H
@@ -0,0 +1,74 @@
+#ifndef PLAYER_SOURCE_H
+#define PLAYER_SOURCE_H
+
+#include "Utils/mapped_file.h"
+#include "Utils/ring_buffer.h"
+#include "common.h"
+
+#include <atomic>
+
+namespace Player {
+
+// Something the Mixer can pull interleaved samples from, in the format described by spec().
+class AudioSource {
+public:
+  explicit AudioSource(const SDL_AudioSpec &spec) : spec_(spec) {}
+
+  virtual ~AudioSource() = default;
+
+  // called on the audio thread, returns bytes written (short only at the end or on underrun)
+  virtual int pull(Byte *stream, int len) = 0;
+
+  [[nodiscard]] virtual bool finished() const = 0;
+
+  // percent of the look-ahead buffer in use, -1 for unbuffered sources
+  [[nodiscard]] virtual int fill() const { return -1; }
+
+  [[nodiscard]] const SDL_AudioSpec &spec() const { return spec_; }
+
+protected:
+  SDL_AudioSpec spec_;
+};
+
+// Fed by a producer thread through a RingBuffer.
+class RingSource : public AudioSource {
+public:
+  RingSource(const SDL_AudioSpec &spec, size_t capacity);
+
+  int pull(Byte *stream, int len) override;
+
+  [[nodiscard]] bool finished() const override;
+
+  [[nodiscard]] int fill() const override;
+
+  // the producer will not write anymore
+  void setEOF() { eof_ = true; }
+
+  RingBuffer &ring() { return ring_; }
+
+private:
+  RingBuffer ring_;
+
+  std::atomic<bool> eof_{false};
+};
+
+// Reads straight out of a memory mapped file.
+class MappedSource : public AudioSource {
+public:
+  explicit MappedSource(const SDL_AudioSpec &spec) : AudioSource(spec) {}
+
+  bool open(const std::string &filename, size_t offset = 0);
+
+  int pull(Byte *stream, int len) override;
+
+  [[nodiscard]] bool finished() const override;
+
+  MappedFile &file() { return file_; }
+
+private:
+  MappedFile file_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_SOURCE_H
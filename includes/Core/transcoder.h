@@ -0,0 +1,74 @@
+#ifndef PLAYER_TRANSCODER_H
+#define PLAYER_TRANSCODER_H
+
+#include "Utils/spec.h"
+#include "common.h"
+
+#include <vector>
+
+namespace Player {
+
+struct TranscodeJob {
+  enum Kind {
+    // PCM -> AAC, Recorder::pcm2AAC
+    Encode,
+    // AAC -> PCM, Audio::decodeAAC
+    Decode,
+    // PCM -> PCM, Recorder::resampleParallel
+    Resample,
+  };
+
+  Kind kind = Encode;
+  // only the filename matters on the AAC side
+  ResampleAudioSpec input{};
+  ResampleAudioSpec output{};
+};
+
+struct TranscodeResult {
+  bool success = false;
+  double seconds = 0;
+  uintmax_t inputBytes = 0;
+  uintmax_t outputBytes = 0;
+};
+
+// Runs batches of encode, decode and resample jobs on a bounded worker pool, one job per worker
+// at a time, and reports per-job timing plus the aggregate throughput.
+class Transcoder {
+public:
+  // 0 threads means one per core
+  explicit Transcoder(size_t threads = 0) : threads_(threads) {}
+
+  void add(const TranscodeJob &job);
+
+  // one job per line, '#' starts a comment:
+  //   encode   <in.pcm> <rate> <fmt> <channels> <out.aac>
+  //   decode   <in.aac> <out.pcm>
+  //   resample <in.pcm> <rate> <fmt> <channels> <out.pcm> <rate> <fmt> <channels>
+  // a job whose output is its input under any name fails the whole manifest
+  bool load(const std::string &manifest);
+
+  // true if every job succeeded
+  bool run();
+
+  [[nodiscard]] const std::vector<TranscodeJob> &jobs() const { return jobs_; }
+
+  [[nodiscard]] const std::vector<TranscodeResult> &results() const { return results_; }
+
+private:
+  static TranscodeResult execute(TranscodeJob &job);
+
+  static bool parse(std::istream &line, ResampleAudioSpec &spec, bool pcm);
+
+  void report(double seconds) const;
+
+private:
+  size_t threads_;
+
+  std::vector<TranscodeJob> jobs_;
+
+  std::vector<TranscodeResult> results_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_TRANSCODER_H
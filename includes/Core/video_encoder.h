@@ -0,0 +1,75 @@
+#ifndef PLAYER_VIDEO_ENCODER_H
+#define PLAYER_VIDEO_ENCODER_H
+
+#include "Utils/frame_pool.h"
+#include "common.h"
+
+namespace Player {
+class Muxer;
+
+// Turns raw frames read off a capture device into a compressed stream of a Muxer. Converts to the
+// encoder's pixel format through a cached SwsContext; the encoder itself runs with frame and slice
+// threading.
+class VideoEncoder {
+public:
+  VideoEncoder() = default;
+
+  ~VideoEncoder();
+
+  VideoEncoder(const VideoEncoder &) = delete;
+
+  VideoEncoder &operator=(const VideoEncoder &) = delete;
+
+  // `input` describes the raw frames, `timeBase` their timestamps; without an `encoder` name
+  // libx264 is tried first, then mpeg4, then ffv1
+  bool open(Muxer &muxer, const AVCodecParameters *input, AVRational timeBase,
+            AVRational frameRate, const std::string &encoder = "");
+
+  // one raw frame as read from the device
+  bool encode(const AVPacket *pkt);
+
+  // flushes the encoder, the muxer stays open
+  void close();
+
+  [[nodiscard]] const char *name() const;
+
+  [[nodiscard]] int64_t frames() const { return count_; }
+
+private:
+  bool openEncoder(const AVCodec *codec, AVRational frameRate, bool globalHeader);
+
+  bool send(AVFrame *frame);
+
+private:
+  Muxer *muxer_ = nullptr;
+
+  int stream_ = -1;
+
+  AVCodecContext *ctx_ = nullptr;
+
+  SwsContext *sws_ = nullptr;
+
+  // wraps the device packet
+  AVFrame *raw_ = nullptr;
+
+  // frames converted to the encoder's pixel format, recycled once the encoder lets go of them
+  FramePool frames_;
+
+  bool convert_ = false;
+
+  int width_ = 0;
+
+  int height_ = 0;
+
+  AVPixelFormat format_ = AV_PIX_FMT_NONE;
+
+  AVRational timeBase_{1, AV_TIME_BASE};
+
+  int64_t lastPts_ = AV_NOPTS_VALUE;
+
+  int64_t count_ = 0;
+};
+
+} // namespace Player
+
+#endif // PLAYER_VIDEO_ENCODER_H
@@ -15,6 +15,9 @@ public:
 
   SDL_Renderer *init();
 
+  // where a width x height picture goes to fill the window without distortion
+  static SDL_Rect fit(int width, int height);
+
 private:
   void deinit();
 
@@ -0,0 +1,62 @@
+#ifndef PLAYER_ADTS_INDEX_H
+#define PLAYER_ADTS_INDEX_H
+
+#include "common.h"
+
+#include <vector>
+
+namespace Player {
+
+// Byte offset of every `interval`-th frame of an ADTS stream. Built once by walking the frame
+// headers (nothing is decoded) and persisted next to the stream as <name>.idx.
+class AdtsIndex {
+public:
+  explicit AdtsIndex(int interval = 64) : interval_(interval) {}
+
+  // loads the sidecar, or builds the index and saves it when the sidecar is missing or stale
+  bool open(const std::string &filename);
+
+  bool build(const std::string &filename);
+
+  bool load(const std::string &filename);
+
+  bool save(const std::string &filename) const;
+
+  // byte offset of the indexed frame at or before `ms`, `skip` is the number of samples to drop
+  // after it to land on `ms`, counted at the decoder's `outputRate` (0 for the header rate)
+  size_t lookup(int64_t ms, int64_t &skip, int outputRate = 0) const;
+
+  [[nodiscard]] int sampleRate() const { return sampleRate_; }
+
+  [[nodiscard]] int64_t duration() const;
+
+  [[nodiscard]] bool empty() const { return entries_.empty(); }
+
+private:
+  struct Entry {
+    uint64_t offset;
+    // samples before this frame
+    int64_t sample;
+  };
+
+  static std::string sidecar(const std::string &filename);
+
+  static int64_t modified(const std::string &filename);
+
+private:
+  int interval_;
+
+  int sampleRate_ = 0;
+
+  int64_t samples_ = 0;
+
+  uint64_t fileSize_ = 0;
+
+  int64_t mtime_ = 0;
+
+  std::vector<Entry> entries_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_ADTS_INDEX_H
@@ -0,0 +1,28 @@
+#ifndef PLAYER_CAPTURE_CLOCK_H
+#define PLAYER_CAPTURE_CLOCK_H
+
+#include "common.h"
+
+namespace Player {
+
+// One monotonic clock shared by every device of a recording. Each device keeps its own packet
+// spacing but is anchored to this clock when its first packet arrives, so streams from devices
+// with unrelated clocks line up.
+class CaptureClock {
+public:
+  struct Anchor {
+    int64_t offset = AV_NOPTS_VALUE;
+  };
+
+  CaptureClock() : start_(av_gettime_relative()) {}
+
+  // rewrites pts/dts to microseconds since the clock was created, call it on the reading thread
+  void stamp(Anchor &anchor, AVPacket *pkt, AVRational timeBase) const;
+
+private:
+  int64_t start_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_CAPTURE_CLOCK_H
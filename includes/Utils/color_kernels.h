@@ -0,0 +1,41 @@
+#ifndef PLAYER_COLOR_KERNELS_H
+#define PLAYER_COLOR_KERNELS_H
+
+#include "common.h"
+
+#include <cstdint>
+
+namespace Player {
+
+// Pixel format conversions for captured frames, same size in and out. Chroma of two yuyv422 rows
+// is averaged into one 4:2:0 row; RGB comes out of BT.601 limited range as BGRA, which is
+// SDL_PIXELFORMAT_ARGB8888 on little endian.
+struct ColorKernels {
+  const char *name;
+
+  void (*yuyvToI420)(const uint8_t *src, int srcStride, uint8_t *y, int yStride, uint8_t *u,
+                     int uStride, uint8_t *v, int vStride, int width, int height);
+
+  void (*yuyvToNV12)(const uint8_t *src, int srcStride, uint8_t *y, int yStride, uint8_t *uv,
+                     int uvStride, int width, int height);
+
+  void (*i420ToBGRA)(const uint8_t *y, int yStride, const uint8_t *u, int uStride,
+                     const uint8_t *v, int vStride, uint8_t *dst, int dstStride, int width,
+                     int height);
+};
+
+// picked once from the CPU features, scalar when nothing better is available
+const ColorKernels &colorKernels();
+
+// always the portable version, the reference for the vectorized ones
+const ColorKernels &scalarColorKernels();
+
+// true when the kernels cover src's format to dst's, callers use swscale otherwise
+bool canConvert(AVPixelFormat src, AVPixelFormat dst);
+
+// `dst` must be allocated with src's size; false when canConvert() says no
+bool convertFrame(const AVFrame *src, AVFrame *dst, const ColorKernels &kernels = colorKernels());
+
+} // namespace Player
+
+#endif // PLAYER_COLOR_KERNELS_H
@@ -0,0 +1,57 @@
+#ifndef PLAYER_FILE_AVIO_H
+#define PLAYER_FILE_AVIO_H
+
+#include "Utils/file_io.h"
+#include "common.h"
+
+namespace Player {
+
+// A FileReader or FileWriter handed to avformat as a seekable custom AVIOContext, so containers
+// get the same read-ahead, preallocation and IOStats as the raw files.
+class FileAVIO {
+public:
+  FileAVIO() = default;
+
+  ~FileAVIO();
+
+  FileAVIO(const FileAVIO &) = delete;
+
+  FileAVIO &operator=(const FileAVIO &) = delete;
+
+  // the context is owned by this object and valid until close(); nullptr on failure
+  AVIOContext *openRead(const std::string &filename);
+
+  AVIOContext *openWrite(const std::string &filename, int64_t preallocate = 0);
+
+  // flushes what avformat still buffers, then closes the file
+  void close();
+
+  [[nodiscard]] bool isOpen() const { return ctx_ != nullptr; }
+
+private:
+  AVIOContext *allocContext(bool write);
+
+  static int readPacket(void *opaque, uint8_t *buf, int size);
+
+#if LIBAVFORMAT_VERSION_MAJOR < 61
+  static int writePacket(void *opaque, uint8_t *buf, int size);
+#else
+  static int writePacket(void *opaque, const uint8_t *buf, int size);
+#endif
+
+  static int64_t seek(void *opaque, int64_t offset, int whence);
+
+private:
+  FileReader reader_;
+
+  FileWriter writer_;
+
+  AVIOContext *ctx_ = nullptr;
+
+  // where avformat writes next; behind the end when it goes back to patch a header
+  int64_t pos_ = 0;
+};
+
+} // namespace Player
+
+#endif // PLAYER_FILE_AVIO_H
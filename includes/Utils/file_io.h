@@ -0,0 +1,226 @@
+#ifndef PLAYER_FILE_IO_H
+#define PLAYER_FILE_IO_H
+
+#include "Utils/stats.h"
+#include "Utils/thread_pool.h"
+#include "common.h"
+
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace Player {
+
+// Where the syscalls of FileReader and FileWriter happen. Requests are positional, so a backend
+// may complete them in any order and on any thread; the result is the number of bytes
+// transferred or -errno.
+class IOBackend {
+public:
+  virtual ~IOBackend() = default;
+
+  virtual std::future<int64_t> read(int fd, void *data, size_t len, int64_t offset) = 0;
+
+  virtual std::future<int64_t> write(int fd, const void *data, size_t len, int64_t offset) = 0;
+
+  [[nodiscard]] virtual const char *name() const = 0;
+
+  // io_uring when it was built in and the kernel allows it, a pread/pwrite pool otherwise;
+  // PLAYER_IO=threads forces the pool
+  static IOBackend &shared();
+};
+
+// pread/pwrite on a few worker threads.
+class ThreadIO : public IOBackend {
+public:
+  explicit ThreadIO(size_t threads = 4) : pool_(threads) {}
+
+  std::future<int64_t> read(int fd, void *data, size_t len, int64_t offset) override;
+
+  std::future<int64_t> write(int fd, const void *data, size_t len, int64_t offset) override;
+
+  [[nodiscard]] const char *name() const override { return "threads"; }
+
+private:
+  ThreadPool pool_;
+};
+
+#ifdef PLAYER_IO_URING
+// One submission ring shared by every file, completions are reaped on a thread of its own.
+class UringIO : public IOBackend {
+public:
+  UringIO();
+
+  ~UringIO() override;
+
+  [[nodiscard]] bool isOpen() const { return open_; }
+
+  std::future<int64_t> read(int fd, void *data, size_t len, int64_t offset) override;
+
+  std::future<int64_t> write(int fd, const void *data, size_t len, int64_t offset) override;
+
+  [[nodiscard]] const char *name() const override { return "io_uring"; }
+
+private:
+  std::future<int64_t> submit(bool write, int fd, void *data, size_t len, int64_t offset);
+
+  void reap();
+
+private:
+  struct Ring;
+
+  Ring *ring_ = nullptr;
+
+  bool open_ = false;
+
+  std::mutex mutex_;
+
+  std::thread reaper_;
+};
+#endif
+
+// Aligned buffer and the request filling or draining it.
+struct IOBlock {
+  static constexpr size_t Size = 1 << 20;
+  // page size, so the buffers would also do for O_DIRECT
+  static constexpr size_t Alignment = 4096;
+
+  Byte *data = nullptr;
+  int64_t offset = -1;
+  size_t size = 0;
+  std::future<int64_t> pending;
+  int64_t submitted = 0;
+
+  IOBlock();
+
+  ~IOBlock();
+
+  IOBlock(const IOBlock &) = delete;
+
+  IOBlock &operator=(const IOBlock &) = delete;
+};
+
+// Sequential reader with one block of read-ahead in flight while the other is consumed.
+class FileReader {
+public:
+  explicit FileReader(IOBackend &backend = IOBackend::shared()) : backend_(backend) {}
+
+  ~FileReader();
+
+  FileReader(const FileReader &) = delete;
+
+  FileReader &operator=(const FileReader &) = delete;
+
+  // the cursor starts at `offset`
+  bool open(const std::string &filename, int64_t offset = 0);
+
+  void close();
+
+  // short only at the end of the file
+  size_t read(void *data, size_t len);
+
+  // what is already buffered is kept when `position` falls inside it
+  void seek(int64_t position);
+
+  // bypasses the read-ahead, for the odd jump elsewhere in the file
+  int64_t readAt(int64_t offset, void *data, size_t len);
+
+  [[nodiscard]] bool isOpen() const { return fd_ >= 0; }
+
+  [[nodiscard]] int64_t tell() const { return pos_; }
+
+  [[nodiscard]] int64_t size() const { return size_; }
+
+  [[nodiscard]] bool eof() const { return pos_ >= size_; }
+
+  [[nodiscard]] const IOStats &stats() const { return stats_; }
+
+private:
+  // makes the current block hold pos_, then starts reading the one after it
+  bool load();
+
+  void prefetch(IOBlock &block, int64_t offset);
+
+  int64_t settle(IOBlock &block);
+
+private:
+  IOBackend &backend_;
+
+  std::string filename_;
+
+  int fd_ = -1;
+
+  int64_t size_ = 0;
+
+  int64_t pos_ = 0;
+
+  IOBlock blocks_[2];
+
+  int current_ = 0;
+
+  IOStats stats_;
+};
+
+// Buffered writer: a full block is handed to the backend while the next one fills. Recordings can
+// preallocate their expected size so the file doesn't fragment as it grows.
+class FileWriter {
+public:
+  explicit FileWriter(IOBackend &backend = IOBackend::shared()) : backend_(backend) {}
+
+  ~FileWriter();
+
+  FileWriter(const FileWriter &) = delete;
+
+  FileWriter &operator=(const FileWriter &) = delete;
+
+  // `truncate` false keeps what is in the file, for writers that fill in regions with writeAt()
+  bool open(const std::string &filename, int64_t preallocate = 0, bool truncate = true);
+
+  // the file is cut back to what was written
+  void close();
+
+  bool write(const void *data, size_t len);
+
+  // overwrites bytes at `offset`, e.g. a header patched at the end; waits for the write
+  bool writeAt(int64_t offset, const void *data, size_t len);
+
+  // waits until everything written so far is with the kernel
+  bool flush();
+
+  [[nodiscard]] bool isOpen() const { return fd_ >= 0; }
+
+  // bytes written so far
+  [[nodiscard]] int64_t size() const { return size_; }
+
+  [[nodiscard]] const IOStats &stats() const { return stats_; }
+
+private:
+  bool submit(IOBlock &block);
+
+  bool settle(IOBlock &block);
+
+  // waits for the whole write, resubmitting the rest when it comes back short
+  bool complete(std::future<int64_t> &pending, const Byte *data, size_t len, int64_t offset);
+
+private:
+  IOBackend &backend_;
+
+  std::string filename_;
+
+  int fd_ = -1;
+
+  int64_t size_ = 0;
+
+  int64_t preallocated_ = 0;
+
+  IOBlock blocks_[2];
+
+  int current_ = 0;
+
+  bool failed_ = false;
+
+  IOStats stats_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_FILE_IO_H
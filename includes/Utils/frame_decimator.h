@@ -0,0 +1,52 @@
+#ifndef PLAYER_FRAME_DECIMATOR_H
+#define PLAYER_FRAME_DECIMATOR_H
+
+#include "common.h"
+
+namespace Player {
+
+// Drops evenly spaced video frames while the writer is behind, so the output degrades to a
+// steady lower rate instead of random holes. The keep ratio steps down in sixths (30 -> 25 -> 20
+// -> 15 -> 10 -> 5 fps at 30) while the writer queue is over half full and back up once it is
+// below a quarter. Kept frames are untouched, timestamps included.
+class FrameDecimator {
+public:
+  explicit FrameDecimator(AVRational frameRate) : frameRate_(frameRate) {}
+
+  // called for every captured frame with the depth of the queue it would go into
+  bool keep(size_t queued, size_t capacity);
+
+  [[nodiscard]] double requestedRate() const;
+
+  // kept frames per second of capture
+  [[nodiscard]] double effectiveRate() const;
+
+  [[nodiscard]] int64_t dropped() const { return seen_ - kept_; }
+
+  void dump() const;
+
+private:
+  static constexpr int Steps = 6;
+
+  AVRational frameRate_;
+
+  // frames kept out of every Steps
+  int level_ = Steps;
+
+  int accumulator_ = 0;
+
+  // frames since the ratio last changed, changes are at least a second apart
+  int64_t held_ = 0;
+
+  int64_t seen_ = 0;
+
+  int64_t kept_ = 0;
+
+  int64_t begin_ = 0;
+
+  int64_t last_ = 0;
+};
+
+} // namespace Player
+
+#endif // PLAYER_FRAME_DECIMATOR_H
@@ -0,0 +1,65 @@
+#ifndef PLAYER_FRAME_POOL_H
+#define PLAYER_FRAME_POOL_H
+
+#include "Utils/stats.h"
+#include "common.h"
+
+#include <mutex>
+#include <vector>
+
+namespace Player {
+
+// Hands out video frames of one geometry whose pixel buffers come from an AVBufferPool. A buffer
+// goes back to the pool once the last reference is gone, so a frame still held by an encoder is
+// never overwritten; the AVFrame shells are recycled as well. Safe to use from several threads.
+class FramePool {
+public:
+  FramePool() = default;
+
+  ~FramePool();
+
+  FramePool(const FramePool &) = delete;
+
+  FramePool &operator=(const FramePool &) = delete;
+
+  // a different geometry starts a new pool, frames handed out before stay valid
+  bool init(AVPixelFormat format, int width, int height);
+
+  void close();
+
+  // writable frame of the configured geometry, nullptr on failure
+  AVFrame *acquire();
+
+  // drops our reference, the buffers are reused once nobody else holds them
+  void release(AVFrame *frame);
+
+  [[nodiscard]] const PoolStats &stats() const { return stats_; }
+
+  void resetStats() { stats_.reset(); }
+
+private:
+#if LIBAVUTIL_VERSION_MAJOR < 57
+  static AVBufferRef *allocate(void *opaque, int size);
+#else
+  static AVBufferRef *allocate(void *opaque, size_t size);
+#endif
+
+private:
+  std::mutex mutex_;
+
+  AVBufferPool *pool_ = nullptr;
+
+  AVPixelFormat format_ = AV_PIX_FMT_NONE;
+
+  int width_ = 0;
+
+  int height_ = 0;
+
+  std::vector<AVFrame *> shells_;
+
+  PoolStats stats_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_FRAME_POOL_H
@@ -0,0 +1,46 @@
+#ifndef PLAYER_INTERLEAVER_H
+#define PLAYER_INTERLEAVER_H
+
+#include "common.h"
+
+#include <vector>
+
+namespace Player {
+
+// Turns decoded audio frames into interleaved samples SDL can play. Packed u8/s16/s32/flt pass
+// through untouched, planar layouts are packed and anything else becomes flt. The output format
+// is fixed by the first frame.
+class Interleaver {
+public:
+  Interleaver() = default;
+
+  ~Interleaver();
+
+  Interleaver(const Interleaver &) = delete;
+
+  Interleaver &operator=(const Interleaver &) = delete;
+
+  // `data` points into the frame or into an internal buffer valid until the next call
+  bool convert(const AVFrame *frame, const Byte *&data, size_t &len);
+
+  [[nodiscard]] AVSampleFormat format() const { return fmt_; }
+
+  // bytes per interleaved sample frame
+  [[nodiscard]] int frameSize() const { return frameSize_; }
+
+private:
+  bool init(const AVFrame *frame);
+
+private:
+  SwrContext *swr_ = nullptr;
+
+  AVSampleFormat fmt_ = AV_SAMPLE_FMT_NONE;
+
+  int frameSize_ = 0;
+
+  std::vector<Byte> buffer_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_INTERLEAVER_H
@@ -0,0 +1,59 @@
+#ifndef PLAYER_MAPPED_FILE_H
+#define PLAYER_MAPPED_FILE_H
+
+#include "common.h"
+
+#include <atomic>
+
+namespace Player {
+
+// Read-only memory mapping of a media file with a single consumer cursor. read() copies straight
+// out of the mapping, so the audio callback can pull from it without an intermediate buffer.
+class MappedFile {
+public:
+  MappedFile() = default;
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // `offset` skips a container header, the cursor starts right after it
+  bool open(const std::string &filename, size_t offset = 0);
+
+  void close();
+
+  size_t read(Byte *data, size_t len);
+
+  // moves the cursor, clamped to the end; not safe against a concurrent read()
+  void seek(size_t position);
+
+  // ask the kernel to page in `window` bytes ahead of the cursor
+  void prefetch(size_t window);
+
+  [[nodiscard]] bool isOpen() const { return data_ != nullptr; }
+
+  [[nodiscard]] const Byte *data() const { return data_ + offset_; }
+
+  [[nodiscard]] size_t size() const { return size_ - offset_; }
+
+  [[nodiscard]] size_t position() const { return pos_.load(std::memory_order_acquire); }
+
+  [[nodiscard]] size_t remaining() const { return size() - position(); }
+
+private:
+  Byte *data_ = nullptr;
+
+  size_t size_ = 0;
+
+  size_t offset_ = 0;
+
+  std::atomic<size_t> pos_{0};
+
+  size_t prefetched_ = 0;
+};
+
+} // namespace Player
+
+#endif // PLAYER_MAPPED_FILE_H
@@ -0,0 +1,77 @@
+#ifndef PLAYER_MEMORY_PIPE_H
+#define PLAYER_MEMORY_PIPE_H
+
+#include "Utils/file_io.h"
+#include "Utils/queue.h"
+#include "common.h"
+
+#include <atomic>
+#include <vector>
+
+namespace Player {
+
+// Byte stream from one thread to another, in chunks through a BoundedQueue so the writer can't
+// run arbitrarily far ahead. Either end can be handed to avformat as a custom AVIOContext.
+class MemoryPipe {
+public:
+  // at most `chunks` writes in flight
+  explicit MemoryPipe(size_t chunks = 64);
+
+  ~MemoryPipe();
+
+  MemoryPipe(const MemoryPipe &) = delete;
+
+  MemoryPipe &operator=(const MemoryPipe &) = delete;
+
+  // also copy everything that goes through to `filename`
+  bool tee(const std::string &filename);
+
+  bool write(const Byte *data, size_t len);
+
+  // blocks until something arrives, 0 once the writer finished
+  size_t read(Byte *data, size_t len);
+
+  // the writer is done
+  void finish();
+
+  // the reader gave up, a blocked writer returns
+  void abort();
+
+  // owned by the pipe, write-only and read-only respectively; not seekable
+  AVIOContext *writer();
+
+  AVIOContext *reader();
+
+  [[nodiscard]] uint64_t bytes() const { return bytes_; }
+
+private:
+  static int readPacket(void *opaque, uint8_t *buf, int size);
+
+#if LIBAVFORMAT_VERSION_MAJOR < 61
+  static int writePacket(void *opaque, uint8_t *buf, int size);
+#else
+  static int writePacket(void *opaque, const uint8_t *buf, int size);
+#endif
+
+  static AVIOContext *allocContext(MemoryPipe *pipe, bool write);
+
+private:
+  BoundedQueue<std::vector<Byte>> chunks_;
+
+  // what the reader took off the queue but hasn't consumed yet
+  std::vector<Byte> current_;
+
+  size_t pos_ = 0;
+
+  AVIOContext *writer_ = nullptr;
+
+  AVIOContext *reader_ = nullptr;
+
+  FileWriter tee_;
+
+  std::atomic<uint64_t> bytes_{0};
+};
+
+} // namespace Player
+
+#endif // PLAYER_MEMORY_PIPE_H
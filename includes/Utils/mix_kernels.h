@@ -0,0 +1,32 @@
+#ifndef PLAYER_MIX_KERNELS_H
+#define PLAYER_MIX_KERNELS_H
+
+#include <cstdint>
+
+namespace Player {
+
+// Interleaved sample kernels used by the Mixer callback. The gain of frame `f` is
+// `gain + step * f`, so a gain change is ramped over one period instead of stepping.
+struct MixKernels {
+  const char *name;
+
+  // dst += src * gain, saturated to the s16 range
+  void (*mixS16)(int16_t *dst, const int16_t *src, int frames, int channels, float gain,
+                 float step);
+
+  // dst += src * gain, not clipped, call clipF32 once every source is mixed
+  void (*mixF32)(float *dst, const float *src, int frames, int channels, float gain, float step);
+
+  // clamp to [-1, 1]
+  void (*clipF32)(float *data, int count);
+};
+
+// picked once from the CPU features, scalar when nothing better is available
+const MixKernels &mixKernels();
+
+// always the portable version, the reference for the vectorized ones
+const MixKernels &scalarMixKernels();
+
+} // namespace Player
+
+#endif // PLAYER_MIX_KERNELS_H
@@ -0,0 +1,67 @@
+#ifndef PLAYER_PACKET_QUEUE_H
+#define PLAYER_PACKET_QUEUE_H
+
+#include "Utils/queue.h"
+#include "Utils/stats.h"
+#include "common.h"
+
+namespace Player {
+
+// Owns the packets it holds, whatever is left on teardown is freed.
+class PacketQueue : public BoundedQueue<AVPacket *> {
+public:
+  explicit PacketQueue(size_t capacity = 64) : BoundedQueue(capacity) {}
+
+  ~PacketQueue() override { clear(); }
+
+protected:
+  void release(AVPacket *&pkt) override { av_packet_free(&pkt); }
+};
+
+class FrameQueue : public BoundedQueue<AVFrame *> {
+public:
+  explicit FrameQueue(size_t capacity = 16) : BoundedQueue(capacity) {}
+
+  ~FrameQueue() override { clear(); }
+
+protected:
+  void release(AVFrame *&frame) override { av_frame_free(&frame); }
+};
+
+// What a full CaptureQueue does with one more packet.
+enum class Overflow {
+  Block,
+  DropOldest,
+  DropNewest,
+};
+
+// Between a capture device and the disk. Blocking would stall the device reads, so by default a
+// full queue drops the oldest packet instead and counts it.
+class CaptureQueue : public PacketQueue {
+public:
+  explicit CaptureQueue(size_t capacity = 256, Overflow overflow = Overflow::DropOldest)
+      : PacketQueue(capacity), overflow_(overflow) {}
+
+  // takes ownership of `pkt`, false once aborted
+  bool offer(AVPacket *pkt);
+
+  // pop() with the byte accounting
+  bool take(AVPacket *&pkt);
+
+  [[nodiscard]] Overflow overflow() const { return overflow_; }
+
+  CaptureStats &stats() { return stats_; }
+
+private:
+  // with the lock held
+  void drop(AVPacket *pkt);
+
+private:
+  Overflow overflow_;
+
+  CaptureStats stats_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_PACKET_QUEUE_H
@@ -0,0 +1,44 @@
+#ifndef PLAYER_PACKET_WRITER_H
+#define PLAYER_PACKET_WRITER_H
+
+#include "Utils/packet_queue.h"
+#include "common.h"
+
+#include <functional>
+#include <thread>
+
+namespace Player {
+
+// Drains a CaptureQueue on a thread of its own, so a slow disk shows up as queue depth and drops
+// instead of stalling the device reads.
+class PacketWriter {
+public:
+  using Write = std::function<void(const AVPacket *)>;
+
+  explicit PacketWriter(CaptureQueue &queue) : queue_(queue) {}
+
+  ~PacketWriter();
+
+  PacketWriter(const PacketWriter &) = delete;
+
+  PacketWriter &operator=(const PacketWriter &) = delete;
+
+  void start(Write write);
+
+  // waits until everything queued before queue.finish() is written
+  void stop();
+
+private:
+  void run();
+
+private:
+  CaptureQueue &queue_;
+
+  Write write_;
+
+  std::thread thread_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_PACKET_WRITER_H
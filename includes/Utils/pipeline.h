@@ -0,0 +1,57 @@
+#ifndef PLAYER_PIPELINE_H
+#define PLAYER_PIPELINE_H
+
+#include "common.h"
+
+#include <deque>
+#include <functional>
+
+namespace Player {
+
+// Runs a chain of stages concurrently, each on a thread of its own, and reports where the time
+// went. The stages share whatever queues or pipes connect them; a stage must finish its output
+// when it returns, and abort its input when it fails so the one upstream doesn't block forever.
+class Pipeline {
+public:
+  class Stage {
+  public:
+    // runs a blocking call on a neighbour and books the time as waiting rather than working
+    template <typename F> auto wait(F &&call) {
+      auto begin = av_gettime_relative();
+      auto result = call();
+      waited_ += av_gettime_relative() - begin;
+      return result;
+    }
+
+  private:
+    friend class Pipeline;
+
+    std::string name_;
+    std::function<bool(Stage &)> body_;
+    int64_t begin_ = 0;
+    int64_t end_ = 0;
+    int64_t waited_ = 0;
+    bool success_ = false;
+  };
+
+  using Body = std::function<bool(Stage &)>;
+
+  void add(const std::string &name, Body body);
+
+  // true when every stage succeeded
+  bool run();
+
+  // when each stage ran and how long it actually worked, against the wall time of the whole run
+  void report() const;
+
+private:
+  std::deque<Stage> stages_;
+
+  int64_t begin_ = 0;
+
+  int64_t end_ = 0;
+};
+
+} // namespace Player
+
+#endif // PLAYER_PIPELINE_H
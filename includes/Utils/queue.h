@@ -0,0 +1,125 @@
+#ifndef PLAYER_QUEUE_H
+#define PLAYER_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace Player {
+
+// Blocking FIFO with a fixed capacity connecting two pipeline threads. The producer calls finish()
+// once it is done, abort() wakes everybody up for teardown.
+template <typename T> class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t capacity = 16) : capacity_(capacity) {}
+
+  virtual ~BoundedQueue() = default;
+
+  BoundedQueue(const BoundedQueue &) = delete;
+
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  // blocks while full, false once aborted
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notFull_.wait(lock, [this] { return aborted_ || items_.size() < capacity_; });
+    if (aborted_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    notEmpty_.notify_one();
+    return true;
+  }
+
+  // blocks while empty, false once aborted or finished and drained
+  bool pop(T &item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notEmpty_.wait(lock, [this] { return aborted_ || finished_ || !items_.empty(); });
+    if (aborted_ || items_.empty()) {
+      return false;
+    }
+    item = std::move(items_.front());
+    items_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+  bool tryPop(T &item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (aborted_ || items_.empty()) {
+      return false;
+    }
+    item = std::move(items_.front());
+    items_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+  void finish() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    notEmpty_.notify_all();
+  }
+
+  void abort() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    aborted_ = true;
+    notEmpty_.notify_all();
+    notFull_.notify_all();
+  }
+
+  // back to an empty, running queue, leftovers go through release()
+  void reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &item : items_) {
+      release(item);
+    }
+    items_.clear();
+    aborted_ = false;
+    finished_ = false;
+    notFull_.notify_all();
+  }
+
+  [[nodiscard]] size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.size();
+  }
+
+  [[nodiscard]] size_t capacity() const { return capacity_; }
+
+  [[nodiscard]] bool finished() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finished_ && items_.empty();
+  }
+
+protected:
+  virtual void release(T &) {}
+
+  // subclasses must call this from their destructor, release() is gone by the time ours runs
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &item : items_) {
+      release(item);
+    }
+    items_.clear();
+  }
+
+protected:
+  mutable std::mutex mutex_;
+
+  std::condition_variable notEmpty_;
+
+  std::condition_variable notFull_;
+
+  std::deque<T> items_;
+
+  size_t capacity_;
+
+  bool finished_ = false;
+
+  bool aborted_ = false;
+};
+
+} // namespace Player
+
+#endif // PLAYER_QUEUE_H
@@ -0,0 +1,72 @@
+#ifndef PLAYER_RING_BUFFER_H
+#define PLAYER_RING_BUFFER_H
+
+#include "common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace Player {
+
+// Single-producer/single-consumer byte ring. read() is lock-free and safe to call from the SDL
+// audio callback; the producer sleeps on a condition instead of spinning while the ring is full.
+class RingBuffer {
+public:
+  RingBuffer() = default;
+
+  explicit RingBuffer(size_t capacity);
+
+  ~RingBuffer();
+
+  RingBuffer(const RingBuffer &) = delete;
+
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  void reset(size_t capacity);
+
+  // drops everything buffered, the consumer must not be reading
+  void clear();
+
+  // producer side
+  size_t write(const Byte *data, size_t len);
+
+  bool waitWritable(size_t len, const std::atomic<bool> &running);
+
+  bool waitEmpty(const std::atomic<bool> &running);
+
+  // consumer side
+  size_t read(Byte *data, size_t len);
+
+  [[nodiscard]] size_t size() const;
+
+  [[nodiscard]] size_t space() const;
+
+  [[nodiscard]] size_t capacity() const { return capacity_; }
+
+  // bytes written and read since the last reset
+  [[nodiscard]] size_t written() const { return head_.load(std::memory_order_acquire); }
+
+  [[nodiscard]] size_t consumed() const { return tail_.load(std::memory_order_acquire); }
+
+private:
+  void wait(const std::atomic<bool> &running);
+
+private:
+  Byte *data_ = nullptr;
+
+  size_t capacity_ = 0;
+
+  // monotonically increasing, position is index % capacity
+  std::atomic<size_t> head_{0};
+
+  std::atomic<size_t> tail_{0};
+
+  std::mutex mutex_;
+
+  std::condition_variable cond_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_RING_BUFFER_H
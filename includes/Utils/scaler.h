@@ -0,0 +1,67 @@
+#ifndef PLAYER_SCALER_H
+#define PLAYER_SCALER_H
+
+#include "Utils/thread_pool.h"
+#include "common.h"
+
+#include <memory>
+#include <vector>
+
+namespace Player {
+
+// Scales and converts frames with swscale, keeping the contexts while the geometry stays the
+// same. A large output is cut into horizontal slices, each produced by its own context on a
+// thread pool from the whole source (sws_send_slice/sws_receive_slice, FFmpeg 5 and later).
+class Scaler {
+public:
+  // 0 threads means one per core; the pool is only started for the first frame worth splitting
+  explicit Scaler(size_t threads = 0, int flags = SWS_BILINEAR)
+      : threads_(threads), flags_(flags) {}
+
+  ~Scaler();
+
+  Scaler(const Scaler &) = delete;
+
+  Scaler &operator=(const Scaler &) = delete;
+
+  // `dst` is allocated with the wanted format and size; `src` must be reference counted
+  bool scale(const AVFrame *src, AVFrame *dst);
+
+  [[nodiscard]] size_t slices() const { return contexts_.size(); }
+
+private:
+  bool configure(const AVFrame *src, const AVFrame *dst);
+
+  void clear();
+
+  bool scaleSlices(const AVFrame *src, AVFrame *dst);
+
+private:
+  size_t threads_;
+
+  int flags_;
+
+  std::unique_ptr<ThreadPool> pool_;
+
+  // one per slice
+  std::vector<SwsContext *> contexts_;
+
+  // output rows each slice produces, the last one takes the rest
+  int sliceRows_ = 0;
+
+  int srcWidth_ = 0;
+
+  int srcHeight_ = 0;
+
+  AVPixelFormat srcFormat_ = AV_PIX_FMT_NONE;
+
+  int dstWidth_ = 0;
+
+  int dstHeight_ = 0;
+
+  AVPixelFormat dstFormat_ = AV_PIX_FMT_NONE;
+};
+
+} // namespace Player
+
+#endif // PLAYER_SCALER_H
@@ -11,6 +11,8 @@ struct Spec {
   int channels = 1;
   // 音频缓冲区样本数量
   int samples = 1024;
+  // 环形缓冲区深度（周期数）
+  int periods = 4;
   AVCodecID codecID = AV_CODEC_ID_NONE;
 
   Spec() = default;
@@ -26,7 +28,8 @@ struct ResampleAudioSpec {
   std::string filename;
   int sampleRate;
   AVSampleFormat fmt;
-  AVChannelLayout channelLayout;
+  // zeroed so av_channel_layout_copy() can write over it
+  AVChannelLayout channelLayout{};
 };
 } // namespace Player
 
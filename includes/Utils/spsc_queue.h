@@ -0,0 +1,55 @@
+#ifndef PLAYER_SPSC_QUEUE_H
+#define PLAYER_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace Player {
+
+// Fixed-capacity single-producer/single-consumer queue. Neither side locks or allocates, so
+// either one may be the audio callback.
+template <typename T> class SpscQueue {
+public:
+  explicit SpscQueue(size_t capacity) : slots_(capacity) {}
+
+  SpscQueue(const SpscQueue &) = delete;
+
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // producer side, false when full
+  bool push(const T &item) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= slots_.size()) {
+      return false;
+    }
+    slots_[tail % slots_.size()] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side, false when empty
+  bool pop(T &item) {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = slots_[head % slots_.size()];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  [[nodiscard]] size_t capacity() const { return slots_.size(); }
+
+private:
+  std::vector<T> slots_;
+
+  // monotonically increasing, the slot is index % capacity
+  std::atomic<size_t> head_{0};
+
+  std::atomic<size_t> tail_{0};
+};
+
+} // namespace Player
+
+#endif // PLAYER_SPSC_QUEUE_H
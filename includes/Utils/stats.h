@@ -0,0 +1,148 @@
+#ifndef PLAYER_STATS_H
+#define PLAYER_STATS_H
+
+#include "common.h"
+
+#include <atomic>
+
+namespace Player {
+
+// Lock-free histogram, cheap enough to update from the audio callback. Buckets are powers of two
+// by default, or `width` wide when one is given (the last bucket collects the overflow).
+class Histogram {
+public:
+  static constexpr int Buckets = 32;
+
+  explicit Histogram(uint64_t width = 0) : width_(width) {}
+
+  void add(uint64_t value);
+
+  void reset();
+
+  [[nodiscard]] uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] double mean() const;
+
+  // upper bound of the bucket holding the p-th percentile, p in [0, 1]
+  [[nodiscard]] uint64_t percentile(double p) const;
+
+  void dump(const char *name, const char *unit, int level = AV_LOG_INFO) const;
+
+private:
+  [[nodiscard]] int bucket(uint64_t value) const;
+
+  [[nodiscard]] uint64_t upperBound(int bucket) const;
+
+private:
+  uint64_t width_;
+
+  std::atomic<uint64_t> buckets_[Buckets]{};
+
+  std::atomic<uint64_t> count_{0};
+
+  std::atomic<uint64_t> sum_{0};
+
+  std::atomic<uint64_t> max_{0};
+};
+
+struct AudioStats {
+  std::atomic<uint64_t> callbacks{0};
+  // periods padded with silence while a source still had data to come
+  std::atomic<uint64_t> underruns{0};
+  // microseconds spent in the callback
+  Histogram duration;
+  // microseconds the callback interval is off from the period length
+  Histogram jitter;
+  // percent of a buffered source's capacity that is filled when the callback runs
+  Histogram fill{10};
+
+  void reset();
+
+  void dump() const;
+};
+
+struct CaptureStats {
+  // packets read off the device
+  std::atomic<uint64_t> packets{0};
+  // packets thrown away because the writer fell behind
+  std::atomic<uint64_t> drops{0};
+  std::atomic<uint64_t> droppedBytes{0};
+  // bytes waiting for the writer, and the most there ever were
+  std::atomic<uint64_t> queuedBytes{0};
+  std::atomic<uint64_t> highWater{0};
+  // microseconds per write
+  Histogram write;
+  // packets still queued each time the writer takes one
+  Histogram depth{1};
+
+  void reset();
+
+  void dump() const;
+};
+
+struct IOStats {
+  std::atomic<uint64_t> bytesRead{0};
+  std::atomic<uint64_t> bytesWritten{0};
+  std::atomic<uint64_t> requests{0};
+  // microseconds the caller sat waiting on a request, against the time the file was open
+  std::atomic<uint64_t> stalled{0};
+  int64_t opened = 0;
+  // microseconds from submitting a request to picking up its result
+  Histogram latency;
+
+  void reset();
+
+  // throughput over the time the file was open, and how much of it went into waiting
+  void dump(const char *name, int level = AV_LOG_INFO) const;
+};
+
+struct VideoStats {
+  std::atomic<uint64_t> shown{0};
+  // frames skipped because their slot had already passed
+  std::atomic<uint64_t> dropped{0};
+  // frames shown more than a quarter of a frame after their slot
+  std::atomic<uint64_t> late{0};
+  // microseconds past its slot each frame went up
+  Histogram lateness;
+
+  void reset();
+
+  void dump() const;
+};
+
+struct PoolStats {
+  std::atomic<uint64_t> requests{0};
+  // requests nothing idle could serve
+  std::atomic<uint64_t> allocated{0};
+  // handed back and kept for reuse, or thrown away because enough were idle already
+  std::atomic<uint64_t> recycled{0};
+  std::atomic<uint64_t> discarded{0};
+
+  // allocations saved by reuse
+  [[nodiscard]] uint64_t avoided() const;
+
+  void reset();
+
+  void dump(const char *name) const;
+};
+
+struct PlaybackStats {
+  VideoStats video;
+  // microseconds between a frame's timestamp and the master clock when it went up
+  Histogram drift;
+  // items waiting in each queue every time a video frame is presented
+  Histogram audioPackets{1};
+  Histogram videoPackets{1};
+  Histogram audioFrames{1};
+  Histogram videoFrames{1};
+
+  void reset();
+
+  void dump() const;
+};
+
+} // namespace Player
+
+#endif // PLAYER_STATS_H
@@ -0,0 +1,53 @@
+#ifndef PLAYER_TEXTURE_POOL_H
+#define PLAYER_TEXTURE_POOL_H
+
+#include "Utils/stats.h"
+#include "common.h"
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace Player {
+
+// Keeps released textures around keyed by (format, width, height, access) so the next request
+// of the same shape reuses one instead of creating it again. Like the renderer, only to be used
+// from the thread that renders.
+class TexturePool {
+public:
+  // at most `idle` textures of each shape are kept
+  explicit TexturePool(SDL_Renderer *renderer, size_t idle = 4)
+      : renderer_(renderer), idle_(idle) {}
+
+  ~TexturePool();
+
+  TexturePool(const TexturePool &) = delete;
+
+  TexturePool &operator=(const TexturePool &) = delete;
+
+  // nullptr on failure
+  SDL_Texture *acquire(uint32_t format, int width, int height, int access);
+
+  // `texture` must not be used anymore, the next owner finds whatever it held
+  void release(SDL_Texture *texture);
+
+  // destroys every idle texture
+  void clear();
+
+  [[nodiscard]] const PoolStats &stats() const { return stats_; }
+
+private:
+  using Key = std::tuple<uint32_t, int, int, int>;
+
+  SDL_Renderer *renderer_;
+
+  size_t idle_;
+
+  std::map<Key, std::vector<SDL_Texture *>> textures_;
+
+  PoolStats stats_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_TEXTURE_POOL_H
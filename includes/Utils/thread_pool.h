@@ -0,0 +1,42 @@
+#ifndef PLAYER_THREAD_POOL_H
+#define PLAYER_THREAD_POOL_H
+
+#include "Utils/queue.h"
+
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace Player {
+
+// Fixed set of worker threads draining a BoundedQueue of tasks. submit() blocks while the queue
+// is full, which keeps a producer from racing ahead of the workers.
+class ThreadPool {
+public:
+  // 0 threads means one per core
+  explicit ThreadPool(size_t threads = 0, size_t queued = 0);
+
+  // runs whatever was submitted, then joins
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  std::future<void> submit(std::function<void()> task);
+
+  [[nodiscard]] size_t size() const { return workers_.size(); }
+
+private:
+  void run();
+
+private:
+  BoundedQueue<std::packaged_task<void()>> tasks_;
+
+  std::vector<std::thread> workers_;
+};
+
+} // namespace Player
+
+#endif // PLAYER_THREAD_POOL_H
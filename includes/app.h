@@ -2,8 +2,13 @@
 #define PLAYER_APP_H
 
 #include "Core/audio.h"
+#include "Core/media_player.h"
+#include "Core/mixer.h"
+#include "Core/raw_video.h"
 #include "Core/recorder.h"
 #include "GUI/window.h"
+#include "Utils/scaler.h"
+#include "Utils/texture_pool.h"
 
 namespace Player {
 
@@ -59,8 +64,14 @@ private:
 
   Audio *audio_ = nullptr;
 
+  Mixer *mixer_ = nullptr;
+
   Recorder *recorder_ = nullptr;
 
+  RawVideo *video_ = nullptr;
+
+  MediaPlayer *player_ = nullptr;
+
   bool running_ = false;
 
   SDL_Joystick *joystick_ = nullptr;
@@ -68,6 +79,12 @@ private:
   SDL_Event event_{};
 
   SDL_Renderer *renderer_ = nullptr;
+
+  // textures of the Images built per event
+  TexturePool *textures_ = nullptr;
+
+  // shrinks raw pictures larger than the window before they are uploaded
+  Scaler *scaler_ = nullptr;
 };
 
 } // namespace Player
@@ -11,9 +11,13 @@ extern "C" {
 
 #include <libavcodec/avcodec.h>
 #include <libavdevice/avdevice.h>
+#include <libavutil/audio_fifo.h>
 #include <libavutil/avutil.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libavutil/time.h>
 #include <libswresample/swresample.h>
+#include <libswscale/swscale.h>
 
 #ifdef __cplusplus
 };
@@ -23,6 +27,8 @@ extern "C" {
 
 #define FMT_NAME "dshow"
 #define DEVICE_NAME ""
+#define AUDIO_DEVICE_NAME DEVICE_NAME
+#define VIDEO_DEVICE_NAME DEVICE_NAME
 
 #elif __APPLE__
 
@@ -30,6 +36,18 @@ extern "C" {
 #define AUDIO_DEVICE_NAME ":1"
 #define VIDEO_DEVICE_NAME "0:"
 
+#elif __linux__
+
+#define FMT_NAME "alsa"
+#define VIDEO_FMT_NAME "v4l2"
+#define AUDIO_DEVICE_NAME "default"
+#define VIDEO_DEVICE_NAME "/dev/video0"
+
+#endif
+
+// 音视频用同一个输入设备时
+#ifndef VIDEO_FMT_NAME
+#define VIDEO_FMT_NAME FMT_NAME
 #endif
 
 #define ClearWhite() ClearWindow(255, 255, 255)
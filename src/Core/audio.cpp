@@ -1,4 +1,13 @@
 #include "Core/audio.h"
+#include "Core/mixer.h"
+#include "Core/decoder.h"
+#include "Core/demuxer.h"
+#include "Core/playlist.h"
+#include "Core/source.h"
+#include "Utils/adts_index.h"
+#include "Utils/file_io.h"
+#include "Utils/interleaver.h"
+#include "Utils/packet_queue.h"
 #include "Utils/spec.h"
 
 #include <filesystem>
@@ -15,6 +24,8 @@
 
 #define AUDIO_INBUF_SIZE 20480
 
+#define WAV_HEADER_SIZE 0x2C
+
 // (header[3] << 24) | (header[2] << 16) | (header[1] << 8) | header[0];
 #define BIG_2_LITTLE(dstType, ...) (*(dstType *)((Byte[]){__VA_ARGS__}))
 
@@ -22,7 +33,12 @@ namespace fs = std::filesystem;
 
 Player::Audio::Audio() { init(); }
 
-Player::Audio::~Audio() { deletePtr(&spec_); }
+Player::Audio::~Audio() {
+  deletePtr(&spec_);
+  if (ownsMixer_) {
+    deletePtr(&mixer_);
+  }
+}
 
 [[maybe_unused]] Player::Audio::Audio(const std::string &name) {
   setFilename(name);
@@ -53,6 +69,7 @@ void Player::Audio::play() {
     stop();
     return;
   }
+  playing_ = true;
   std::thread audio(&Player::Audio::run, this);
   audio.detach();
 }
@@ -65,63 +82,458 @@ void Player::Audio::playWAV() {
   if (p.extension().string() != ".wav") {
     return;
   }
+
+  if (playing_) {
+    stop();
+    return;
+  }
+  playing_ = true;
   std::thread audio(&Player::Audio::runWAV, this);
   audio.detach();
 }
 
-void Player::Audio::stop() { playing_ = false; }
+void Player::Audio::stop() {
+  playing_ = false;
+  seekTarget_ = -1;
+}
 
-void pullAudioData(void *userdata, Byte *stream, int len) {
-  SDL_memset(stream, 0, len);
-  auto buffer = (Player::AudioBuffer *)userdata;
-  if (buffer->len < 1) {
-    return;
-  }
-  buffer->pullSize = len > buffer->len ? buffer->len : len;
-  SDL_MixAudio(stream, buffer->data, buffer->pullSize, SDL_MIX_MAXVOLUME);
-  buffer->data += buffer->pullSize;
-  buffer->len -= buffer->pullSize;
+void Player::Audio::seek(int64_t ms) { seekTarget_ = std::max<int64_t>(ms, 0); }
+
+size_t Player::Audio::byteOffset(const SDL_AudioSpec &spec, int64_t ms) {
+  // a whole number of frames (WAV block align) so the channels stay in place
+  auto frameSize = (size_t)(SDL_AUDIO_BITSIZE(spec.format) >> 3) * spec.channels;
+  return (size_t)(ms * spec.freq / 1000) * frameSize;
 }
 
 void Player::Audio::runWAV() {
-  SDL_AudioSpec spec;
-  std::ifstream input;
-  AudioBuffer audioBuffer;
-  if (!(playing_ = parseWAV(spec, input))) {
+  SDL_AudioSpec spec{};
+  FileReader input;
+  if (!(playing_ = parseWAV(filename(), spec, input))) {
     return;
   }
-  spec.callback = pullAudioData;
-  spec.userdata = &audioBuffer;
+  auto bitsPerSample = SDL_AUDIO_BITSIZE(spec.format);
+  auto bytesPerSample = (bitsPerSample * spec.channels) >> 3;
+  start(spec, input, WAV_HEADER_SIZE, spec.samples * bytesPerSample);
+}
+
+SDL_AudioFormat Player::Audio::getSDLFormat(AVSampleFormat fmt) {
+  switch (fmt) {
+  case AV_SAMPLE_FMT_U8:
+    return AUDIO_U8;
+  case AV_SAMPLE_FMT_S16:
+    return AUDIO_S16SYS;
+  case AV_SAMPLE_FMT_S32:
+    return AUDIO_S32SYS;
+  case AV_SAMPLE_FMT_FLT:
+    return AUDIO_F32SYS;
+  default:
+    return 0;
+  }
+}
+
+void Player::Audio::run() {
+  SDL_AudioSpec spec{};
+  spec.freq = sampleRate();
+  spec.channels = channels();
+  spec.format = format();
+  spec.samples = samples();
+  FileReader input;
+  playing_ = true;
+  start(spec, input, 0, bufferSize());
+}
 
-  if (SDL_OpenAudio(&spec, nullptr)) {
+void Player::Audio::start(const SDL_AudioSpec &spec, FileReader &input, size_t offset,
+                          int period) {
+  auto mapped = std::make_shared<MappedSource>(spec);
+  if (mapped->open(filename(), offset)) {
+    input.close();
+    playMapped(mapped, period);
+    playing_ = false;
     return;
   }
 
-  SDL_PauseAudio(0);
+  if (!input.isOpen() && !input.open(filename(), (int64_t)offset)) {
+    playing_ = false;
+    return;
+  }
+  input.seek((int64_t)offset);
+  feed(input, std::make_shared<RingSource>(spec, (size_t)period * periods()), period);
+  input.close();
+  playing_ = false;
+}
 
-  auto bitsPerSample = SDL_AUDIO_BITSIZE(spec.format);
-  auto bytesPerSample = (bitsPerSample * spec.channels) >> 3;
-  auto bufSize = spec.samples * bytesPerSample;
-  Byte buffer[bufSize];
+void Player::Audio::feed(FileReader &input, const std::shared_ptr<RingSource> &source,
+                         int period) {
+  std::vector<Byte> buffer(period);
+  // prefill the ring before attaching so the first callbacks don't underrun
+  auto prefill = source->ring().capacity() - period;
+  bool attached = false;
+  auto origin = input.tell();
   while (playing_) {
-    if (audioBuffer.len) {
+    auto ms = seekTarget_.exchange(-1);
+    if (ms >= 0) {
+      auto move = [&] {
+        source->ring().clear();
+        input.seek(origin + (int64_t)byteOffset(source->spec(), ms));
+      };
+      if (attached) {
+        mixer()->reposition(channel_, move);
+      } else {
+        move();
+      }
+    }
+    auto len = input.read(buffer.data(), period);
+    if (len < 1) {
+      if (!awaitSeek(source, attached)) {
+        break;
+      }
       continue;
     }
-    audioBuffer.len = input.read(reinterpret_cast<char *>(buffer), bufferSize()).gcount();
-    if (audioBuffer.len < 1) {
-      auto ms = audioBuffer.pullSize / bytesPerSample / spec.freq;
-      SDL_Delay(ms * 1000);
+    if (!push(source, buffer.data(), len, prefill, attached)) {
       break;
     }
-    audioBuffer.data = buffer;
   }
+  drain(source, attached);
+}
 
-  input.close();
-  SDL_CloseAudio();
+bool Player::Audio::awaitSeek(const std::shared_ptr<RingSource> &source, bool &attached) {
+  if (!attached && !(attached = attach(source))) {
+    return false;
+  }
+  // the tail is still playing, a seek until it has been heard brings the feeder back
+  auto &spec = source->spec();
+  auto ms = std::max<Uint32>(1, spec.samples * 1000 / spec.freq);
+  while (playing_ && seekTarget_ < 0 && source->ring().size() > 0) {
+    SDL_Delay(ms);
+  }
+  return playing_ && seekTarget_ >= 0;
+}
+
+bool Player::Audio::push(const std::shared_ptr<RingSource> &source, const Byte *data, size_t len,
+                         size_t prefill, bool &attached) {
+  auto &ring = source->ring();
+  while (len > 0) {
+    if (!ring.waitWritable(len, playing_)) {
+      return false;
+    }
+    auto size = ring.write(data, len);
+    data += size;
+    len -= size;
+    if (!attached && ring.size() >= prefill && !(attached = attach(source))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Player::Audio::drain(const std::shared_ptr<RingSource> &source, bool &attached) {
+  source->setEOF();
+  if (!attached) {
+    attached = attach(source);
+  }
+  if (attached) {
+    source->ring().waitEmpty(playing_);
+    detach();
+  }
+}
+
+void Player::Audio::playAAC() {
+  if (filename().empty()) {
+    return;
+  }
+
+  if (playing_) {
+    stop();
+    return;
+  }
+  playing_ = true;
+  std::thread audio(&Player::Audio::runAAC, this);
+  audio.detach();
+}
+
+void Player::Audio::runAAC() {
+  std::shared_ptr<RingSource> source;
+  Interleaver interleaver;
+  AdtsIndex index;
+  size_t period = 0;
+  size_t offset = 0;
+  int64_t skip = 0;
+  bool attached = false;
+
+  playing_ = true;
+  auto onFrame = [&](AVCodecContext *, AVFrame *frame) {
+    const Byte *data = nullptr;
+    size_t len = 0;
+    if (seekTarget_ >= 0 || !interleaver.convert(frame, data, len)) {
+      return false;
+    }
+    if (skip > 0) {
+      auto frames = std::min<int64_t>(skip, frame->nb_samples);
+      auto bytes = std::min((size_t)frames * interleaver.frameSize(), len);
+      data += bytes;
+      len -= bytes;
+      skip -= frames;
+      if (len < 1) {
+        return true;
+      }
+    }
+    if (!source) {
+      // the stream parameters are only known once the first frame is out
+      SDL_AudioSpec spec{};
+      spec.freq = frame->sample_rate;
+      spec.channels = frame->ch_layout.nb_channels;
+      spec.format = getSDLFormat(interleaver.format());
+      spec.samples = samples();
+      period = (size_t)spec.samples * interleaver.frameSize();
+      source = std::make_shared<RingSource>(spec, period * periods());
+    }
+    // start as soon as one period is decoded, the ring bounds the look-ahead
+    return push(source, data, len, period, attached);
+  };
+  while (playing_) {
+    decodeAAC(filename(), onFrame, offset);
+    if (seekTarget_ < 0 && !(source && awaitSeek(source, attached))) {
+      break;
+    }
+    auto ms = seekTarget_.exchange(-1);
+    // the index is only built (or loaded) on the first seek
+    if (ms < 0 || (index.empty() && !index.open(filename()))) {
+      break;
+    }
+    offset = index.lookup(ms, skip, source ? source->spec().freq : 0);
+    if (source) {
+      auto &ring = source->ring();
+      if (attached) {
+        mixer()->reposition(channel_, [&ring] { ring.clear(); });
+      } else {
+        ring.clear();
+      }
+    }
+  }
+  if (source) {
+    drain(source, attached);
+  }
+  playing_ = false;
+}
+
+struct Player::Audio::Track {
+  std::shared_ptr<AudioSource> source;
+
+  std::shared_ptr<MappedSource> mapped;
+
+  // fallback when the file can't be mapped
+  std::shared_ptr<RingSource> ring;
+  std::unique_ptr<FileReader> input;
+  std::vector<Byte> buffer;
+
+  size_t period = 0;
+
+  size_t window = 0;
+};
+
+void Player::Audio::enqueue(const std::string &name) {
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  queue_.push_back(name);
+}
+
+void Player::Audio::clearQueue() {
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  queue_.clear();
+}
+
+bool Player::Audio::dequeue(std::string &name) {
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  if (queue_.empty()) {
+    return false;
+  }
+  name = queue_.front();
+  queue_.pop_front();
+  return true;
+}
+
+void Player::Audio::playQueue() {
+  if (playing_) {
+    stop();
+    return;
+  }
+  playing_ = true;
+  std::thread audio(&Player::Audio::runQueue, this);
+  audio.detach();
+}
+
+void Player::Audio::runQueue() {
+  std::shared_ptr<Playlist> playlist;
+  std::deque<Track> tracks;
+  bool attached = false;
+  Uint32 ms = 1;
+
+  while (playing_) {
+    if (playlist) {
+      playlist->collect();
+    }
+    while (!tracks.empty() && tracks.front().source->finished()) {
+      tracks.pop_front();
+    }
+    // the current track plus the next one, opened and buffered ahead of the switch
+    std::string name;
+    while (tracks.size() < 2 && dequeue(name)) {
+      Track track;
+      if (!load(name, track)) {
+        continue;
+      }
+      if (!playlist) {
+        auto &spec = track.source->spec();
+        playlist = std::make_shared<Playlist>(spec);
+        ms = std::max<Uint32>(1, spec.samples * 1000 / spec.freq);
+      }
+      if (playlist->append(track.source)) {
+        tracks.push_back(std::move(track));
+      }
+    }
+    if (tracks.empty() && (!playlist || playlist->finished())) {
+      break;
+    }
+    for (auto &track : tracks) {
+      pump(track);
+    }
+    if (!attached && !(attached = attach(playlist))) {
+      break;
+    }
+    SDL_Delay(ms);
+  }
+  if (attached) {
+    detach();
+  }
   playing_ = false;
 }
 
-bool Player::Audio::parseWAV(SDL_AudioSpec &spec, std::ifstream &input) const {
+bool Player::Audio::load(const std::string &name, Track &track) const {
+  SDL_AudioSpec spec{};
+  size_t offset = 0;
+  track.input = std::make_unique<FileReader>();
+  if (fs::path(name).extension().string() == ".wav") {
+    if (!parseWAV(name, spec, *track.input)) {
+      av_log(nullptr, AV_LOG_ERROR, "Failed to parse %s\n", name.c_str());
+      return false;
+    }
+    offset = WAV_HEADER_SIZE;
+  } else {
+    spec.freq = sampleRate();
+    spec.channels = channels();
+    spec.format = format();
+    spec.samples = samples();
+  }
+  track.period = (size_t)spec.samples * ((SDL_AUDIO_BITSIZE(spec.format) * spec.channels) >> 3);
+  track.window = track.period * periods();
+
+  auto mapped = std::make_shared<MappedSource>(spec);
+  if (mapped->open(name, offset)) {
+    track.input.reset();
+    track.source = track.mapped = mapped;
+  } else {
+    if (!track.input->isOpen() && !track.input->open(name)) {
+      return false;
+    }
+    track.input->seek((int64_t)offset);
+    track.ring = std::make_shared<RingSource>(spec, track.window);
+    track.source = track.ring;
+    track.buffer.resize(track.period);
+  }
+  pump(track);
+  return true;
+}
+
+// keep the look-ahead of a track full without blocking the other one
+void Player::Audio::pump(Track &track) {
+  if (track.mapped) {
+    track.mapped->file().prefetch(track.window);
+    return;
+  }
+  auto &ring = track.ring->ring();
+  while (track.input->isOpen() && ring.space() >= track.period) {
+    auto len = track.input->read(track.buffer.data(), track.period);
+    ring.write(track.buffer.data(), len);
+    if (len < track.period) {
+      track.input->close();
+      track.ring->setEOF();
+    }
+  }
+}
+
+void Player::Audio::playMapped(const std::shared_ptr<MappedSource> &source, int period) {
+  auto &file = source->file();
+  auto window = (size_t)period * periods();
+  file.prefetch(window);
+  if (!attach(source)) {
+    return;
+  }
+
+  // nothing to read here, this thread only keeps the pages ahead of the callback resident
+  auto &spec = source->spec();
+  auto ms = std::max<Uint32>(1, spec.samples * 1000 / spec.freq);
+  while (playing_ && !source->finished()) {
+    SDL_Delay(ms);
+    auto target = seekTarget_.exchange(-1);
+    if (target >= 0) {
+      mixer()->reposition(channel_, [&] { file.seek(byteOffset(spec, target)); });
+    }
+    file.prefetch(window);
+  }
+  // the callback that emptied the mapping only queued the last period, and a converted channel
+  // still holds a tail; the channel stays until the callback after it has run
+  auto &callbacks = stats().callbacks;
+  auto last = callbacks.load() + 2;
+  while (playing_ && callbacks.load() < last) {
+    SDL_Delay(ms);
+  }
+  detach();
+}
+
+bool Player::Audio::attach(const std::shared_ptr<AudioSource> &source) {
+  channel_ = mixer()->add(source, gain());
+  return channel_ != 0;
+}
+
+void Player::Audio::detach() {
+  mixer()->remove(channel_);
+  channel_ = 0;
+  dumpStats();
+}
+
+const Player::AudioStats &Player::Audio::stats() { return mixer()->stats(); }
+
+void Player::Audio::dumpStats() {
+  av_log(nullptr, AV_LOG_INFO, "%s:\n", filename().c_str());
+  stats().dump();
+}
+
+void Player::Audio::setMixer(Mixer *mixer) {
+  if (ownsMixer_) {
+    deletePtr(&mixer_);
+    ownsMixer_ = false;
+  }
+  mixer_ = mixer;
+}
+
+Player::Mixer *Player::Audio::mixer() {
+  if (!mixer_) {
+    mixer_ = new Mixer();
+    ownsMixer_ = true;
+  }
+  return mixer_;
+}
+
+void Player::Audio::setGain(float gain) {
+  gain_ = gain;
+  if (channel_) {
+    mixer()->setGain(channel_, gain);
+  }
+}
+
+float Player::Audio::gain() const { return gain_; }
+
+bool Player::Audio::parseWAV(const std::string &name, SDL_AudioSpec &spec,
+                             FileReader &input) const {
   bool success;
   std::vector<Byte> header;
   std::string chunkID;
@@ -132,16 +544,12 @@ bool Player::Audio::parseWAV(SDL_AudioSpec &spec, std::ifstream &input) const {
   uint32_t sampleRate;
   uint16_t bitsPerSample;
 
-  input.open(filename(), std::ios::binary);
-  if (!input.is_open()) {
-    SDL_CloseAudio();
+  header.resize(WAV_HEADER_SIZE);
+  if (!input.open(name) || input.read(&header[0], WAV_HEADER_SIZE) < WAV_HEADER_SIZE) {
     success = false;
     goto end;
   }
 
-  header.resize(0x2C);
-  input.read(reinterpret_cast<char *>(&header[0]), 0x2C);
-
   // [0, 4)
   chunkID = std::string{&header[0], &header[4]};
   if (chunkID != "RIFF") {
@@ -220,49 +628,6 @@ SDL_AudioFormat Player::Audio::getSDLFormat(uint16_t audioFormat, uint16_t bitsP
   return format;
 }
 
-void Player::Audio::run() {
-  SDL_AudioSpec spec;
-  spec.freq = sampleRate();
-  spec.channels = channels();
-  spec.format = format();
-  spec.samples = samples();
-  spec.callback = pullAudioData;
-  AudioBuffer audioBuffer;
-  spec.userdata = &audioBuffer;
-
-  if (SDL_OpenAudio(&spec, nullptr)) {
-    return;
-  }
-
-  std::ifstream input;
-  input.open(filename(), std::ios::binary);
-  if (!input.is_open()) {
-    SDL_CloseAudio();
-    return;
-  }
-
-  SDL_PauseAudio(0);
-
-  playing_ = true;
-  Byte buffer[bufferSize()];
-  while (playing_) {
-    if (audioBuffer.len) {
-      continue;
-    }
-    audioBuffer.len = input.read(reinterpret_cast<char *>(buffer), bufferSize()).gcount();
-    if (audioBuffer.len < 1) {
-      auto ms = audioBuffer.pullSize / bytesPerSample() / spec.freq;
-      SDL_Delay(ms * 1000);
-      break;
-    }
-    audioBuffer.data = buffer;
-  }
-
-  input.close();
-  SDL_CloseAudio();
-  playing_ = false;
-}
-
 int Player::Audio::sampleRate() const { return spec()->sampleRate; }
 
 Player::Audio::AudioFormat Player::Audio::format() const { return format_; }
@@ -285,6 +650,10 @@ int Player::Audio::samples() const { return spec()->samples; }
 
 [[maybe_unused]] void Player::Audio::setSamples(int samples) const { spec()->samples = samples; }
 
+int Player::Audio::periods() const { return spec()->periods; }
+
+[[maybe_unused]] void Player::Audio::setPeriods(int periods) const { spec()->periods = periods; }
+
 int Player::Audio::bufferSize() { return samples() * bytesPerSample(); }
 
 int Player::Audio::bytesPerSample() const {
@@ -302,19 +671,96 @@ void Player::Audio::decodeAAC() {
   decodeAAC(name, spec);
 }
 
-void Player::Audio::decodeAAC(const std::string &name, Player::ResampleAudioSpec &spec) {
-  std::ifstream input;
-  input.open(name);
-  if (!input.is_open()) {
+bool Player::Audio::decodeAAC(const std::string &name, Player::ResampleAudioSpec &spec) {
+  FileWriter output;
+  if (!output.open(spec.filename)) {
+    return false;
+  }
+  // the native decoder only emits fltp, the .pcm file wants the channels interleaved
+  Interleaver interleaver;
+  bool success = decodeAAC(name, [&](AVCodecContext *ctx, AVFrame *frame) {
+    const Byte *data = nullptr;
+    size_t len = 0;
+    if (!interleaver.convert(frame, data, len) || !output.write(data, len)) {
+      return false;
+    }
+    spec.sampleRate = ctx->sample_rate;
+    // a custom layout's map belongs to the decoder
+    return av_channel_layout_copy(&spec.channelLayout, &ctx->ch_layout) == 0;
+  });
+  success = output.flush() && success;
+  output.close();
+  spec.fmt = interleaver.format();
+  return success;
+}
+
+void Player::Audio::decodeFile(const std::string &name, Player::ResampleAudioSpec &spec) {
+  Demuxer demuxer;
+  Decoder decoder;
+  PacketQueue packets;
+  FrameQueue frames;
+  Interleaver interleaver;
+  FileWriter output;
+  AVFrame *frame = nullptr;
+  int64_t samples = 0;
+  auto begin = av_gettime_relative();
+
+  if (!demuxer.open(name)) {
+    return;
+  }
+  int index = demuxer.bestStream(AVMEDIA_TYPE_AUDIO);
+  if (index < 0) {
+    av_log(nullptr, AV_LOG_ERROR, "No audio stream in %s\n", name.c_str());
+    return;
+  }
+  if (!decoder.open(demuxer.stream(index))) {
     return;
   }
-  std::ofstream output;
-  output.open(spec.filename);
-  if (!output.is_open()) {
+  if (!output.open(spec.filename)) {
     return;
   }
 
+  demuxer.route(index, &packets);
+  decoder.start(&packets, &frames);
+  demuxer.start();
+  while (frames.pop(frame)) {
+    const Byte *data = nullptr;
+    size_t len = 0;
+    bool ok = interleaver.convert(frame, data, len);
+    if (ok) {
+      output.write(data, len);
+      samples += frame->nb_samples;
+      spec.sampleRate = frame->sample_rate;
+      // a custom layout's map belongs to the frame
+      ok = av_channel_layout_copy(&spec.channelLayout, &frame->ch_layout) == 0;
+    }
+    av_frame_free(&frame);
+    if (!ok) {
+      break;
+    }
+  }
+  demuxer.stop();
+  decoder.stop();
+  output.close();
+  spec.fmt = interleaver.format();
+
+  if (spec.sampleRate > 0) {
+    auto elapsed = (double)(av_gettime_relative() - begin) / AV_TIME_BASE;
+    auto duration = (double)samples / spec.sampleRate;
+    av_log(nullptr, AV_LOG_INFO, "Decoded %.2fs of audio in %.2fs (%.1fx realtime)\n", duration,
+           elapsed, elapsed > 0 ? duration / elapsed : 0);
+  }
+}
+
+bool Player::Audio::decodeAAC(const std::string &name, const FrameHandler &onFrame,
+                              size_t offset) {
+  FileReader input;
+  if (!input.open(name, (int64_t)offset)) {
+    return false;
+  }
+
   bool end = false;
+  bool success = false;
   Byte buffer[AUDIO_INBUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
   Byte *readBuffer = buffer;
   int readLength = 0;
@@ -326,15 +772,19 @@ void Player::Audio::decodeAAC(const std::string &name, Player::ResampleAudioSpec
 
   auto decoderName = "libfdk_aac";
   const AVCodec *codec = avcodec_find_decoder_by_name(decoderName);
+  if (!codec) {
+    // stock builds only ship the native decoder
+    codec = avcodec_find_decoder(AV_CODEC_ID_AAC);
+  }
   if (!codec) {
     av_log(nullptr, AV_LOG_ERROR, "Can not find decoder by %s\n", decoderName);
-    return;
+    return false;
   }
 
   parserCtx = av_parser_init(codec->id);
   if (!parserCtx) {
     av_log(nullptr, AV_LOG_ERROR, "Failed to call av_parser_init\n");
-    return;
+    return false;
   }
 
   ctx = avcodec_alloc_context3(codec);
@@ -394,10 +844,7 @@ void Player::Audio::decodeAAC(const std::string &name, Player::ResampleAudioSpec
 //    }
 //  }
 
-    while ((readLength =
-                (int)input.read(reinterpret_cast<char *>(buffer), AUDIO_INBUF_SIZE).gcount())
-                >
-           0) {
+    while ((readLength = (int)input.read(buffer, AUDIO_INBUF_SIZE)) > 0) {
       readBuffer = buffer;
       while (readLength > 0) {
         ret = av_parser_parse2(parserCtx, ctx, &pkt->data, &pkt->size, readBuffer, readLength,
@@ -408,7 +855,7 @@ void Player::Audio::decodeAAC(const std::string &name, Player::ResampleAudioSpec
         }
         readBuffer += ret;
         readLength -= ret;
-        if (pkt->size > 0 && decode(ctx, pkt, frame, output) < 0) {
+        if (pkt->size > 0 && decode(ctx, pkt, frame, onFrame) < 0) {
           goto end;
         }
       }
@@ -416,23 +863,19 @@ void Player::Audio::decodeAAC(const std::string &name, Player::ResampleAudioSpec
 
   pkt->data = nullptr;
   pkt->size = 0;
-  decode(ctx, pkt, frame, output);
-
-  spec.sampleRate = ctx->sample_rate;
-  spec.fmt = ctx->sample_fmt;
-  spec.channelLayout = ctx->ch_layout;
+  success = decode(ctx, pkt, frame, onFrame) >= 0;
 
 end:
   input.close();
-  output.close();
   av_packet_free(&pkt);
   av_frame_free(&frame);
   av_parser_close(parserCtx);
   avcodec_free_context(&ctx);
+  return success;
 }
 
 int Player::Audio::decode(AVCodecContext *ctx, AVPacket *pkt, AVFrame *frame,
-                          std::ofstream &output) {
+                          const FrameHandler &onFrame) {
   int ret = avcodec_send_packet(ctx, pkt);
   if (ret < 0) {
     log_error(ret);
@@ -446,7 +889,11 @@ int Player::Audio::decode(AVCodecContext *ctx, AVPacket *pkt, AVFrame *frame,
       log_error(ret);
       break;
     }
-    output.write(reinterpret_cast<const char *>(frame->data[0]), frame->linesize[0]);
+    bool next = onFrame(ctx, frame);
+    av_frame_unref(frame);
+    if (!next) {
+      return AVERROR_EXIT;
+    }
   }
   return ret;
 }
@@ -0,0 +1,180 @@
+#include "Core/audio_encoder.h"
+#include "Core/muxer.h"
+
+Player::AudioEncoder::~AudioEncoder() { close(); }
+
+bool Player::AudioEncoder::open(Muxer &muxer, const AVCodecParameters *input,
+                                AVSampleFormat inputFmt, int sampleRate) {
+  close();
+  muxer_ = &muxer;
+  pts_ = AV_NOPTS_VALUE;
+  inputFrameSize_ = input->ch_layout.nb_channels * av_get_bytes_per_sample(inputFmt);
+
+  AVDictionary *opts = nullptr;
+  auto encoderName = "libfdk_aac";
+  const AVCodec *codec = avcodec_find_encoder_by_name(encoderName);
+  if (codec) {
+    av_dict_set(&opts, "vbr", "1", 0);
+  } else {
+    codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+  }
+  if (!codec) {
+    av_log(nullptr, AV_LOG_ERROR, "Can not find encoder by %s\n", encoderName);
+    return false;
+  }
+
+  ctx_ = avcodec_alloc_context3(codec);
+  if (!ctx_) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call avcodec_alloc_context3");
+    av_dict_free(&opts);
+    return false;
+  }
+  ctx_->sample_rate = sampleRate;
+  ctx_->ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+  // the resampler converts straight into whatever the encoder takes
+  ctx_->sample_fmt = codec->sample_fmts[0];
+  ctx_->time_base = {1, ctx_->sample_rate};
+  // without it libfdk_aac emits ADTS itself, which the adts muxer passes through
+  if (muxer.globalHeader()) {
+    ctx_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+  int ret = avcodec_open2(ctx_, codec, &opts);
+  av_dict_free(&opts);
+  if (ret < 0) {
+    log_error(ret);
+    close();
+    return false;
+  }
+
+  ret = swr_alloc_set_opts2(&swr_, &ctx_->ch_layout, ctx_->sample_fmt, ctx_->sample_rate,
+                            &input->ch_layout, inputFmt, input->sample_rate, 0, nullptr);
+  if (ret < 0 || (ret = swr_init(swr_)) < 0) {
+    log_error(ret);
+    close();
+    return false;
+  }
+
+  fifo_ = av_audio_fifo_alloc(ctx_->sample_fmt, ctx_->ch_layout.nb_channels, ctx_->frame_size * 2);
+  frame_ = av_frame_alloc();
+  if (!fifo_ || !frame_) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to allocate the encoder buffers");
+    close();
+    return false;
+  }
+  frame_->nb_samples = ctx_->frame_size;
+  frame_->format = ctx_->sample_fmt;
+  // the frame frees its layout, a custom map must not be the encoder's
+  if ((ret = av_channel_layout_copy(&frame_->ch_layout, &ctx_->ch_layout)) < 0 ||
+      (ret = av_frame_get_buffer(frame_, 0)) < 0) {
+    log_error(ret);
+    close();
+    return false;
+  }
+
+  if ((stream_ = muxer.addStream(ctx_)) < 0) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool Player::AudioEncoder::encode(const AVPacket *pkt) {
+  if (!ctx_ || inputFrameSize_ < 1) {
+    return false;
+  }
+  if (pts_ == AV_NOPTS_VALUE) {
+    pts_ = pkt->pts == AV_NOPTS_VALUE ? 0 : av_rescale_q(pkt->pts, AV_TIME_BASE_Q, ctx_->time_base);
+  }
+  int samples = pkt->size / inputFrameSize_;
+  int size = swr_get_out_samples(swr_, samples);
+  if (size > convertedSize_) {
+    if (converted_) {
+      av_freep(&converted_[0]);
+    }
+    av_freep(&converted_);
+    if (av_samples_alloc_array_and_samples(&converted_, nullptr, ctx_->ch_layout.nb_channels, size,
+                                           ctx_->sample_fmt, 0) < 0) {
+      convertedSize_ = 0;
+      return false;
+    }
+    convertedSize_ = size;
+  }
+  const Byte *data = pkt->data;
+  int len = swr_convert(swr_, converted_, convertedSize_, &data, samples);
+  if (len > 0) {
+    av_audio_fifo_write(fifo_, reinterpret_cast<void **>(converted_), len);
+  }
+  return len >= 0 && drain(false);
+}
+
+bool Player::AudioEncoder::drain(bool flush) {
+  while (av_audio_fifo_size(fifo_) >= ctx_->frame_size ||
+         (flush && av_audio_fifo_size(fifo_) > 0)) {
+    int samples = std::min(av_audio_fifo_size(fifo_), ctx_->frame_size);
+    if (av_frame_make_writable(frame_) < 0) {
+      return false;
+    }
+    frame_->nb_samples = samples;
+    av_audio_fifo_read(fifo_, reinterpret_cast<void **>(frame_->data), samples);
+    frame_->pts = pts_;
+    pts_ += samples;
+    if (!send(frame_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Player::AudioEncoder::send(AVFrame *frame) {
+  int ret = avcodec_send_frame(ctx_, frame);
+  if (ret < 0) {
+    log_error(ret);
+    return false;
+  }
+  while (true) {
+    auto pkt = av_packet_alloc();
+    if (!pkt) {
+      return false;
+    }
+    if ((ret = avcodec_receive_packet(ctx_, pkt)) < 0) {
+      av_packet_free(&pkt);
+      break;
+    }
+    pkt->stream_index = stream_;
+    if (!muxer_->write(pkt)) {
+      return false;
+    }
+  }
+  if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+    return true;
+  }
+  log_error(ret);
+  return false;
+}
+
+void Player::AudioEncoder::close() {
+  if (ctx_ && stream_ >= 0) {
+    // whatever the resampler still holds, then the encoder
+    int ret;
+    while (convertedSize_ > 0 &&
+           (ret = swr_convert(swr_, converted_, convertedSize_, nullptr, 0)) > 0) {
+      av_audio_fifo_write(fifo_, reinterpret_cast<void **>(converted_), ret);
+    }
+    if (pts_ != AV_NOPTS_VALUE && drain(true)) {
+      send(nullptr);
+    }
+  }
+  stream_ = -1;
+  if (converted_) {
+    av_freep(&converted_[0]);
+  }
+  av_freep(&converted_);
+  convertedSize_ = 0;
+  av_audio_fifo_free(fifo_);
+  fifo_ = nullptr;
+  av_frame_free(&frame_);
+  swr_free(&swr_);
+  avcodec_free_context(&ctx_);
+}
+
+const char *Player::AudioEncoder::name() const { return ctx_ ? ctx_->codec->name : ""; }
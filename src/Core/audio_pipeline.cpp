@@ -0,0 +1,158 @@
+#include "Core/audio_pipeline.h"
+#include "Core/audio_encoder.h"
+#include "Core/decoder.h"
+#include "Core/demuxer.h"
+#include "Core/muxer.h"
+#include "Core/recorder.h"
+#include "Utils/file_io.h"
+#include "Utils/interleaver.h"
+#include "Utils/memory_pipe.h"
+#include "Utils/packet_queue.h"
+#include "Utils/spec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+// 每个送给编码器的包里的输出样本数
+#define PIPELINE_SAMPLES 4096
+
+namespace fs = std::filesystem;
+
+bool Player::AudioPipeline::run(const ResampleAudioSpec &input,
+                                const ResampleAudioSpec &resampled, ResampleAudioSpec &decoded,
+                                bool keep) {
+  PacketQueue pcm(32);
+  MemoryPipe aac;
+  FileWriter copy;
+  if (keep) {
+    auto aacFilename = fs::path(resampled.filename).replace_extension("aac").string();
+    if (!copy.open(resampled.filename) || !aac.tee(aacFilename)) {
+      return false;
+    }
+  }
+
+  // each stage finishes what it feeds, and aborts what feeds it when it fails
+  Pipeline pipeline;
+  pipeline.add("resample", [&](Pipeline::Stage &stage) {
+    bool success = resample(stage, input, resampled, keep ? &copy : nullptr, pcm);
+    copy.close();
+    pcm.finish();
+    return success;
+  });
+  pipeline.add("encode", [&](Pipeline::Stage &stage) {
+    bool success = encode(stage, resampled, pcm, aac);
+    if (!success) {
+      pcm.abort();
+    }
+    aac.finish();
+    return success;
+  });
+  pipeline.add("decode", [&](Pipeline::Stage &stage) {
+    bool success = decode(stage, aac, decoded);
+    if (!success) {
+      aac.abort();
+    }
+    return success;
+  });
+  bool success = pipeline.run();
+  pipeline.report();
+  return success;
+}
+
+bool Player::AudioPipeline::resample(Pipeline::Stage &stage, const ResampleAudioSpec &input,
+                                     const ResampleAudioSpec &output, FileWriter *copy,
+                                     PacketQueue &pcm) {
+  int outputFrameSize = output.channelLayout.nb_channels * av_get_bytes_per_sample(output.fmt);
+  auto packetSize = (size_t)PIPELINE_SAMPLES * outputFrameSize;
+  // chunks are resampled on a pool and come back in order, the encoder gets them in packets
+  return Recorder::resampleParallel(input, output, [&](const Byte *data, size_t len) {
+    if (copy) {
+      copy->write(data, len);
+    }
+    while (len > 0) {
+      auto size = std::min(len, packetSize);
+      auto pkt = av_packet_alloc();
+      if (!pkt || av_new_packet(pkt, (int)size) < 0) {
+        av_packet_free(&pkt);
+        return false;
+      }
+      memcpy(pkt->data, data, size);
+      if (!stage.wait([&] { return pcm.push(pkt); })) {
+        av_packet_free(&pkt);
+        return false;
+      }
+      data += size;
+      len -= size;
+    }
+    return true;
+  });
+}
+
+bool Player::AudioPipeline::encode(Pipeline::Stage &stage, const ResampleAudioSpec &spec,
+                                   PacketQueue &pcm, MemoryPipe &aac) {
+  Muxer muxer;
+  AudioEncoder encoder;
+  auto params = avcodec_parameters_alloc();
+  if (!params) {
+    return false;
+  }
+  params->sample_rate = spec.sampleRate;
+  bool success = av_channel_layout_copy(&params->ch_layout, &spec.channelLayout) == 0 &&
+                 muxer.open(aac.writer(), "adts") &&
+                 encoder.open(muxer, params, spec.fmt, spec.sampleRate) && muxer.start();
+  avcodec_parameters_free(&params);
+
+  AVPacket *pkt = nullptr;
+  while (success && stage.wait([&] { return pcm.pop(pkt); })) {
+    success = encoder.encode(pkt);
+    av_packet_free(&pkt);
+  }
+  encoder.close();
+  muxer.close();
+  return success;
+}
+
+bool Player::AudioPipeline::decode(Pipeline::Stage &stage, MemoryPipe &aac,
+                                   ResampleAudioSpec &spec) {
+  Demuxer demuxer;
+  Decoder decoder;
+  PacketQueue packets;
+  FrameQueue frames;
+  Interleaver interleaver;
+  FileWriter output;
+  AVFrame *frame = nullptr;
+  bool success = true;
+
+  // probing blocks until the encoder's first frames are through
+  if (!stage.wait([&] { return demuxer.open(aac.reader(), "adts"); })) {
+    return false;
+  }
+  int index = demuxer.bestStream(AVMEDIA_TYPE_AUDIO);
+  if (index < 0 || !decoder.open(demuxer.stream(index)) || !output.open(spec.filename)) {
+    return false;
+  }
+
+  demuxer.route(index, &packets);
+  decoder.start(&packets, &frames);
+  demuxer.start();
+  while (stage.wait([&] { return frames.pop(frame); })) {
+    const Byte *data = nullptr;
+    size_t len = 0;
+    success = interleaver.convert(frame, data, len);
+    if (success) {
+      output.write(data, len);
+      spec.sampleRate = frame->sample_rate;
+      // a custom layout's map belongs to the frame
+      success = av_channel_layout_copy(&spec.channelLayout, &frame->ch_layout) == 0;
+    }
+    av_frame_free(&frame);
+    if (!success) {
+      break;
+    }
+  }
+  demuxer.stop();
+  decoder.stop();
+  spec.fmt = interleaver.format();
+  return success;
+}
@@ -0,0 +1,108 @@
+#include "Core/decoder.h"
+#include "Utils/packet_queue.h"
+
+Player::Decoder::~Decoder() { close(); }
+
+bool Player::Decoder::open(const AVStream *stream, int threads) {
+  close();
+  auto params = stream->codecpar;
+  const AVCodec *codec = avcodec_find_decoder(params->codec_id);
+  if (!codec) {
+    av_log(nullptr, AV_LOG_ERROR, "Can not find decoder for %s\n",
+           avcodec_get_name(params->codec_id));
+    return false;
+  }
+
+  ctx_ = avcodec_alloc_context3(codec);
+  if (!ctx_) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call avcodec_alloc_context3");
+    return false;
+  }
+
+  int ret = avcodec_parameters_to_context(ctx_, params);
+  if (ret < 0) {
+    log_error(ret);
+    goto fail;
+  }
+  ctx_->pkt_timebase = stream->time_base;
+  ctx_->thread_count = threads;
+  ctx_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+  ret = avcodec_open2(ctx_, codec, nullptr);
+  if (ret < 0) {
+    log_error(ret);
+    goto fail;
+  }
+  return true;
+
+fail:
+  avcodec_free_context(&ctx_);
+  return false;
+}
+
+void Player::Decoder::close() {
+  stop();
+  avcodec_free_context(&ctx_);
+}
+
+bool Player::Decoder::start(PacketQueue *packets, FrameQueue *frames) {
+  if (!ctx_ || running_) {
+    return false;
+  }
+  packets_ = packets;
+  frames_ = frames;
+  running_ = true;
+  thread_ = std::thread(&Player::Decoder::run, this);
+  return true;
+}
+
+void Player::Decoder::stop() {
+  running_ = false;
+  if (thread_.joinable()) {
+    packets_->abort();
+    frames_->abort();
+    thread_.join();
+  }
+}
+
+void Player::Decoder::run() {
+  AVPacket *pkt = nullptr;
+  while (running_ && packets_->pop(pkt)) {
+    int ret = avcodec_send_packet(ctx_, pkt);
+    av_packet_free(&pkt);
+    if (ret < 0 && ret != AVERROR_INVALIDDATA) {
+      log_error(ret);
+      break;
+    }
+    if (!receive()) {
+      break;
+    }
+  }
+
+  if (running_ && packets_->finished()) {
+    // drain the frames still buffered in the codec
+    avcodec_send_packet(ctx_, nullptr);
+    receive();
+  }
+  frames_->finish();
+  running_ = false;
+}
+
+bool Player::Decoder::receive() {
+  while (true) {
+    auto frame = av_frame_alloc();
+    int ret = avcodec_receive_frame(ctx_, frame);
+    if (ret < 0) {
+      av_frame_free(&frame);
+      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+        return true;
+      }
+      log_error(ret);
+      return false;
+    }
+    if (!frames_->push(frame)) {
+      av_frame_free(&frame);
+      return false;
+    }
+  }
+}
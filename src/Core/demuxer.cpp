@@ -0,0 +1,139 @@
+#include "Core/demuxer.h"
+#include "Utils/packet_queue.h"
+
+#include <chrono>
+#include <filesystem>
+
+// 网络和实时输入暂时没有数据时，重试前等待的时间(毫秒)
+#define DEMUXER_RETRY_MS 5
+
+namespace fs = std::filesystem;
+
+Player::Demuxer::~Demuxer() { close(); }
+
+bool Player::Demuxer::open(const std::string &filename) {
+  close();
+  std::error_code ec;
+  if (!fs::is_regular_file(filename, ec)) {
+    return openInput(filename.c_str(), nullptr, nullptr);
+  }
+  auto pb = file_.openRead(filename);
+  return pb && openInput(filename.c_str(), pb, nullptr);
+}
+
+bool Player::Demuxer::open(AVIOContext *pb, const char *format) {
+  close();
+  return pb && openInput(nullptr, pb, format);
+}
+
+bool Player::Demuxer::openInput(const char *url, AVIOContext *pb, const char *format) {
+  if (pb) {
+    if (!(ctx_ = avformat_alloc_context())) {
+      return false;
+    }
+    ctx_->pb = pb;
+    ctx_->flags |= AVFMT_FLAG_CUSTOM_IO;
+  }
+  auto input = format ? av_find_input_format(format) : nullptr;
+  // frees ctx_ on failure
+  int ret = avformat_open_input(&ctx_, url, input, nullptr);
+  if (ret < 0) {
+    log_error(ret);
+    file_.close();
+    return false;
+  }
+  return findStreamInfo();
+}
+
+bool Player::Demuxer::findStreamInfo() {
+  int ret = avformat_find_stream_info(ctx_, nullptr);
+  if (ret < 0) {
+    log_error(ret);
+    avformat_close_input(&ctx_);
+    file_.close();
+    return false;
+  }
+  return true;
+}
+
+void Player::Demuxer::close() {
+  stop();
+  queues_.clear();
+  avformat_close_input(&ctx_);
+  file_.close();
+}
+
+int Player::Demuxer::bestStream(AVMediaType type) const {
+  if (!ctx_) {
+    return -1;
+  }
+  int ret = av_find_best_stream(ctx_, type, -1, -1, nullptr, 0);
+  return ret < 0 ? -1 : ret;
+}
+
+AVStream *Player::Demuxer::stream(int index) const {
+  if (!ctx_ || index < 0 || index >= (int)ctx_->nb_streams) {
+    return nullptr;
+  }
+  return ctx_->streams[index];
+}
+
+void Player::Demuxer::route(int index, PacketQueue *queue) { queues_[index] = queue; }
+
+bool Player::Demuxer::start() {
+  if (!ctx_ || running_) {
+    return false;
+  }
+  running_ = true;
+  thread_ = std::thread(&Player::Demuxer::run, this);
+  return true;
+}
+
+void Player::Demuxer::stop() {
+  running_ = false;
+  if (thread_.joinable()) {
+    // unblock a push into a full queue
+    for (auto &[index, queue] : queues_) {
+      queue->abort();
+    }
+    thread_.join();
+  }
+}
+
+void Player::Demuxer::run() {
+  auto pkt = av_packet_alloc();
+  if (!pkt) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call av_packet_alloc");
+    goto end;
+  }
+  while (running_) {
+    int ret = av_read_frame(ctx_, pkt);
+    if (ret == AVERROR(EAGAIN)) {
+      // stop() is noticed within one wait
+      std::this_thread::sleep_for(std::chrono::milliseconds(DEMUXER_RETRY_MS));
+      continue;
+    } else if (ret < 0) {
+      if (ret != AVERROR_EOF) {
+        log_error(ret);
+      }
+      break;
+    }
+    auto it = queues_.find(pkt->stream_index);
+    if (it == queues_.end()) {
+      av_packet_unref(pkt);
+      continue;
+    }
+    auto packet = av_packet_alloc();
+    av_packet_move_ref(packet, pkt);
+    if (!it->second->push(packet)) {
+      av_packet_free(&packet);
+      break;
+    }
+  }
+
+end:
+  for (auto &[index, queue] : queues_) {
+    queue->finish();
+  }
+  av_packet_free(&pkt);
+}
@@ -1,18 +1,39 @@
 #include "Core/image.h"
+#include "Core/raw_video.h"
 #include "GUI/window.h"
-
-#include <filesystem>
-
-namespace fs = std::filesystem;
+#include "Utils/file_io.h"
+#include "Utils/scaler.h"
+#include "Utils/texture_pool.h"
 
 Player::Image::~Image() { deinit(); }
 
-Player::Image::Image(SDL_Renderer *renderer) { renderer_ = renderer; }
+Player::Image::Image(SDL_Renderer *renderer, TexturePool *pool, Scaler *scaler)
+    : renderer_(renderer), pool_(pool), scaler_(scaler) {}
 
 void Player::Image::deinit() {
-  if (texture_) {
+  if (!texture_) {
+    return;
+  }
+  if (pool_) {
+    pool_->release(texture_);
+  } else {
     SDL_DestroyTexture(texture_);
   }
+  texture_ = nullptr;
+}
+
+bool Player::Image::acquire(uint32_t format, int width, int height, int access) {
+  deinit();
+  if (pool_) {
+    texture_ = pool_->acquire(format, width, height, access);
+    return texture_ != nullptr;
+  }
+  texture_ = SDL_CreateTexture(renderer(), format, access, width, height);
+  if (!texture_) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    return false;
+  }
+  return true;
 }
 
 void Player::Image::load(const std::string &filename) {
@@ -25,14 +46,23 @@ void Player::Image::load(const std::string &filename) {
     av_log(nullptr, AV_LOG_ERROR, "Failed to load picture\n");
     return;
   }
-  texture_ = SDL_CreateTextureFromSurface(renderer(), surface);
-  if (!texture_) {
+  // one pixel format for every picture, so textures of the same size can be shared
+  auto converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+  SDL_FreeSurface(surface);
+  if (!converted) {
     av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
     return;
   }
-  setWidth(surface->w);
-  setHeight(surface->h);
-  SDL_FreeSurface(surface);
+  if (acquire(SDL_PIXELFORMAT_ARGB8888, converted->w, converted->h, SDL_TEXTUREACCESS_STATIC)) {
+    if (SDL_UpdateTexture(texture_, nullptr, converted->pixels, converted->pitch)) {
+      av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    } else {
+      SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+      setWidth(converted->w);
+      setHeight(converted->h);
+    }
+  }
+  SDL_FreeSurface(converted);
 }
 
 void Player::Image::setWidth(int width) { width_ = width; }
@@ -46,56 +76,42 @@ int Player::Image::height() const { return height_; }
 bool Player::Image::fit() const { return width() <= height(); }
 
 void Player::Image::createTexture() {
-  auto texture =
-      SDL_CreateTexture(renderer(), SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_TARGET, 50, 50);
-  if (!texture) {
-    av_log(nullptr, AV_LOG_ERROR, "Failed to create surface\n");
+  if (!acquire(SDL_PIXELFORMAT_RGB24, 50, 50, SDL_TEXTUREACCESS_TARGET)) {
     return;
   }
-  if (SDL_SetRenderTarget(renderer(), texture)) {
+  if (SDL_SetRenderTarget(renderer(), texture_)) {
     av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    deinit();
     return;
   }
 
-  if (SDL_SetRenderDrawColor(renderer(), 100, 100, 0, SDL_ALPHA_OPAQUE)) {
-    return;
-  }
-
+  // a recycled texture still holds the last drawing
+  bool drawn = false;
   SDL_Rect rect = {0, 0, 50, 50};
-  if (SDL_RenderDrawRect(renderer(), &rect)) {
-    return;
-  }
-
-  if (SDL_RenderDrawLine(renderer(), 0, 0, 50, 50)) {
-    return;
-  }
-
-  if (SDL_RenderDrawLine(renderer(), 50, 0, 0, 50)) {
-    return;
-  }
-
-  if (SDL_RenderDrawLine(renderer(), 25, 0, 25, 50)) {
-    return;
-  }
-
-  if (SDL_RenderDrawLine(renderer(), 0, 25, 50, 25)) {
+  if (!SDL_SetRenderDrawColor(renderer(), 255, 255, 255, SDL_ALPHA_OPAQUE) &&
+      !SDL_RenderClear(renderer()) &&
+      !SDL_SetRenderDrawColor(renderer(), 100, 100, 0, SDL_ALPHA_OPAQUE) &&
+      !SDL_RenderDrawRect(renderer(), &rect) && !SDL_RenderDrawLine(renderer(), 0, 0, 50, 50) &&
+      !SDL_RenderDrawLine(renderer(), 50, 0, 0, 50) &&
+      !SDL_RenderDrawLine(renderer(), 25, 0, 25, 50) &&
+      !SDL_RenderDrawLine(renderer(), 0, 25, 50, 25)) {
+    drawn = true;
+  }
+  // back to drawing on the window
+  SDL_SetRenderTarget(renderer(), nullptr);
+  if (!drawn) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    deinit();
     return;
   }
 
   setWidth(50);
   setHeight(50);
-  texture_ = texture;
 }
 
 void Player::Image::render() {
   ClearWhite();
-  SDL_Rect dstRect = {0, 0, WIDTH, HEIGHT};
-  if (fit()) {
-    auto w = (width() * HEIGHT * 1.0) / height() * 1.0;
-    auto x = (WIDTH * 1.0 - w) / 2;
-    dstRect.x = static_cast<int>(x);
-    dstRect.w = static_cast<int>(w);
-  }
+  auto dstRect = Window::fit(width(), height());
   SDL_RenderCopyEx(renderer(), texture_, nullptr, &dstRect, 0, nullptr, SDL_FLIP_NONE);
   SDL_RenderPresent(renderer());
 }
@@ -111,27 +127,98 @@ void Player::Image::load(const std::string &filename, int width, int height, uin
     av_log(nullptr, AV_LOG_ERROR, "image file isn't set\n");
     return;
   }
-  std::ifstream input;
-  input.open(filename, std::ios::binary);
-  if (!input.is_open()) {
-    av_log(nullptr, AV_LOG_ERROR, "Failed to open file\n");
+  FileReader input;
+  if (!input.open(filename)) {
     return;
   }
-  texture_ = SDL_CreateTexture(renderer(), format, SDL_TEXTUREACCESS_STREAMING, width, height);
-  if (!texture_) {
-    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+  // only the first frame is shown, read into a buffer the scaler can reference as it is
+  auto size = RawVideo::frameSize(format, width, height);
+  auto buffer = size ? av_buffer_alloc(size) : nullptr;
+  if (!buffer || input.read(buffer->data, size) != size) {
+    av_log(nullptr, AV_LOG_ERROR, "%s is shorter than one %dx%d frame\n", filename.c_str(), width,
+           height);
+    av_buffer_unref(&buffer);
     return;
   }
-  //  int len = (int) input.seekg(0, std::ios::end).tellg();
-  fs::path p(filename);
-  int len = (int)file_size(p);
-  auto buffer = new char[len];
+  auto fit = Window::fit(width, height);
+  bool shrunk =
+      scaler_ && (width > fit.w || height > fit.h) && shrink(buffer, format, width, height);
+  // otherwise the full picture goes up and the renderer stretches it
+  if (!shrunk && acquire(format, width, height, SDL_TEXTUREACCESS_STREAMING)) {
+    if (SDL_UpdateTexture(texture_, nullptr, buffer->data, RawVideo::pitch(format, width))) {
+      av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    } else {
+      setWidth(width);
+      setHeight(height);
+    }
+  }
+  av_buffer_unref(&buffer);
+}
 
-  input.read(buffer, len);
-  if (SDL_UpdateTexture(texture_, nullptr, buffer, width)) {
+bool Player::Image::shrink(AVBufferRef *buffer, uint32_t format, int width, int height) {
+  auto fit = Window::fit(width, height);
+  bool swapChroma = false;
+  AVPixelFormat pixelFormat;
+  switch (format) {
+  case SDL_PIXELFORMAT_YV12:
+    swapChroma = true;
+    pixelFormat = AV_PIX_FMT_YUV420P;
+    break;
+  case SDL_PIXELFORMAT_IYUV:
+    pixelFormat = AV_PIX_FMT_YUV420P;
+    break;
+  case SDL_PIXELFORMAT_NV12:
+    pixelFormat = AV_PIX_FMT_NV12;
+    break;
+  case SDL_PIXELFORMAT_NV21:
+    pixelFormat = AV_PIX_FMT_NV21;
+    break;
+  case SDL_PIXELFORMAT_YUY2:
+    pixelFormat = AV_PIX_FMT_YUYV422;
+    break;
+  case SDL_PIXELFORMAT_UYVY:
+    pixelFormat = AV_PIX_FMT_UYVY422;
+    break;
+  case SDL_PIXELFORMAT_YVYU:
+    pixelFormat = AV_PIX_FMT_YVYU422;
+    break;
+  default:
+    return false;
+  }
+
+  bool success = false;
+  auto src = av_frame_alloc();
+  auto dst = av_frame_alloc();
+  if (!src || !dst || !(src->buf[0] = av_buffer_ref(buffer))) {
+    goto end;
+  }
+  src->format = pixelFormat;
+  src->width = width;
+  src->height = height;
+  av_image_fill_arrays(src->data, src->linesize, buffer->data, pixelFormat, width, height, 1);
+  if (swapChroma) {
+    std::swap(src->data[1], src->data[2]);
+  }
+
+  // 4:2:0 wants even sizes
+  dst->format = AV_PIX_FMT_YUV420P;
+  dst->width = std::max(fit.w & ~1, 2);
+  dst->height = std::max(fit.h & ~1, 2);
+  if (av_frame_get_buffer(dst, 0) < 0 || !scaler_->scale(src, dst) ||
+      !acquire(SDL_PIXELFORMAT_IYUV, dst->width, dst->height, SDL_TEXTUREACCESS_STREAMING)) {
+    goto end;
+  }
+  if (SDL_UpdateYUVTexture(texture_, nullptr, dst->data[0], dst->linesize[0], dst->data[1],
+                           dst->linesize[1], dst->data[2], dst->linesize[2])) {
     av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
-    return;
+    goto end;
   }
-  setWidth(width);
-  setHeight(height);
+  setWidth(dst->width);
+  setHeight(dst->height);
+  success = true;
+
+end:
+  av_frame_free(&src);
+  av_frame_free(&dst);
+  return success;
 }
@@ -0,0 +1,329 @@
+#include "Core/media_player.h"
+#include "Core/audio.h"
+#include "Core/mixer.h"
+#include "Core/source.h"
+#include "GUI/window.h"
+#include "Utils/color_kernels.h"
+#include "Utils/interleaver.h"
+
+// 音频缓冲: 每个周期的采样数和周期数
+#define PLAYER_AUDIO_SAMPLES 1024
+#define PLAYER_AUDIO_PERIODS 8
+// 等待解码时的轮询间隔(毫秒)
+#define PLAYER_POLL_MS 5
+
+Player::MediaPlayer::~MediaPlayer() { close(); }
+
+bool Player::MediaPlayer::open(const std::string &filename) {
+  close();
+  if (!demuxer_.open(filename)) {
+    return false;
+  }
+  audioPackets_.reset();
+  videoPackets_.reset();
+  audioFrames_.reset();
+  videoFrames_.reset();
+  stats_.reset();
+  audioEnd_ = AV_NOPTS_VALUE;
+  audioOrigin_ = 0;
+  offset_ = AV_NOPTS_VALUE;
+
+  // either stream can be missing or undecodable, the other one still plays
+  if (!openAudio()) {
+    audioIndex_ = -1;
+  }
+  if (!openVideo()) {
+    videoIndex_ = -1;
+  }
+  if (audioIndex_ < 0 && videoIndex_ < 0) {
+    av_log(nullptr, AV_LOG_ERROR, "Nothing to play in %s\n", filename.c_str());
+    demuxer_.close();
+    return false;
+  }
+  audioDone_ = audioIndex_ < 0;
+  playing_ = true;
+  if (audioIndex_ >= 0) {
+    demuxer_.route(audioIndex_, &audioPackets_);
+    audioDecoder_.start(&audioPackets_, &audioFrames_);
+    feeder_ = std::thread(&Player::MediaPlayer::feed, this);
+  }
+  if (videoIndex_ >= 0) {
+    demuxer_.route(videoIndex_, &videoPackets_);
+    videoDecoder_.start(&videoPackets_, &videoFrames_);
+  }
+  return demuxer_.start();
+}
+
+bool Player::MediaPlayer::openAudio() {
+  audioIndex_ = demuxer_.bestStream(AVMEDIA_TYPE_AUDIO);
+  return audioIndex_ >= 0 && mixer_ && audioDecoder_.open(demuxer_.stream(audioIndex_));
+}
+
+bool Player::MediaPlayer::openVideo() {
+  videoIndex_ = demuxer_.bestStream(AVMEDIA_TYPE_VIDEO);
+  if (videoIndex_ < 0 || !renderer_) {
+    return false;
+  }
+  auto stream = demuxer_.stream(videoIndex_);
+  if (!videoDecoder_.open(stream)) {
+    return false;
+  }
+  auto rate = av_guess_frame_rate(demuxer_.context(), stream, nullptr);
+  frameDuration_ = rate.num > 0 && rate.den > 0 ? av_rescale(AV_TIME_BASE, rate.den, rate.num)
+                                                : AV_TIME_BASE / 25;
+  return true;
+}
+
+void Player::MediaPlayer::close() {
+  playing_ = false;
+  // unblocks the decoders and the feeder before they are joined
+  demuxer_.stop();
+  audioDecoder_.close();
+  videoDecoder_.close();
+  audioFrames_.abort();
+  if (feeder_.joinable()) {
+    feeder_.join();
+  }
+  if (channel_) {
+    mixer_->remove(channel_);
+    channel_ = 0;
+  }
+  source_.reset();
+  demuxer_.close();
+
+  if (stats_.video.shown || stats_.video.dropped) {
+    stats_.dump();
+  }
+  stats_.reset();
+  av_frame_free(&pending_);
+  av_frame_free(&converted_);
+  if (texture_) {
+    SDL_DestroyTexture(texture_);
+    texture_ = nullptr;
+  }
+  audioIndex_ = -1;
+  videoIndex_ = -1;
+}
+
+int64_t Player::MediaPlayer::timestamp(const AVFrame *frame, const AVStream *stream) const {
+  if (frame->best_effort_timestamp == AV_NOPTS_VALUE) {
+    return AV_NOPTS_VALUE;
+  }
+  return av_rescale_q(frame->best_effort_timestamp, stream->time_base, AV_TIME_BASE_Q);
+}
+
+void Player::MediaPlayer::feed() {
+  Interleaver interleaver;
+  AVFrame *frame = nullptr;
+  auto stream = demuxer_.stream(audioIndex_);
+  while (playing_ && audioFrames_.pop(frame)) {
+    const Byte *data = nullptr;
+    size_t len = 0;
+    bool ok = interleaver.convert(frame, data, len);
+    if (ok && !source_) {
+      SDL_AudioSpec spec{};
+      spec.freq = frame->sample_rate;
+      spec.channels = frame->ch_layout.nb_channels;
+      spec.format = Audio::getSDLFormat(interleaver.format());
+      spec.samples = PLAYER_AUDIO_SAMPLES;
+      byteRate_ = (int64_t)spec.freq * interleaver.frameSize();
+      source_ = std::make_shared<RingSource>(
+          spec, (size_t)PLAYER_AUDIO_SAMPLES * PLAYER_AUDIO_PERIODS * interleaver.frameSize());
+    }
+    if (ok) {
+      auto pts = timestamp(frame, stream);
+      if (pts == AV_NOPTS_VALUE) {
+        pts = audioEnd_ == AV_NOPTS_VALUE ? 0 : audioEnd_.load();
+      }
+      ok = push(data, len, pts);
+    }
+    av_frame_free(&frame);
+    if (!ok) {
+      break;
+    }
+  }
+
+  if (source_) {
+    source_->setEOF();
+    if (!channel_ && playing_) {
+      channel_ = mixer_->add(source_);
+    }
+    source_->ring().waitEmpty(playing_);
+  }
+  // the video runs on by the wall clock from here
+  audioDone_ = true;
+}
+
+bool Player::MediaPlayer::push(const Byte *data, size_t len, int64_t pts) {
+  auto &ring = source_->ring();
+  // start once the ring is nearly full so the first callbacks don't underrun
+  auto prefill = ring.capacity() - ring.capacity() / PLAYER_AUDIO_PERIODS;
+  audioOrigin_ = pts - (int64_t)ring.written() * AV_TIME_BASE / byteRate_;
+  size_t written = 0;
+  while (len > 0) {
+    if (!ring.waitWritable(len, playing_)) {
+      return false;
+    }
+    auto size = ring.write(data, len);
+    data += size;
+    len -= size;
+    written += size;
+    audioEnd_ = pts + (int64_t)written * AV_TIME_BASE / byteRate_;
+    if (!channel_ && ring.size() >= prefill && !(channel_ = mixer_->add(source_))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int64_t Player::MediaPlayer::clock() {
+  auto now = av_gettime_relative();
+  if (channel_ && !audioDone_) {
+    // the ring is only read inside callbacks, so its read position only moves a period at a time;
+    // the wall time since that callback fills in between, up to the period it queued
+    size_t consumed = 0;
+    auto period = mixer_->period([&] { consumed = source_->ring().consumed(); });
+    if (!period.start) {
+      return AV_NOPTS_VALUE;
+    }
+    auto elapsed = std::min(now - period.start, period.duration);
+    auto clock = audioOrigin_ + (int64_t)consumed * AV_TIME_BASE / byteRate_ - period.duration +
+                 elapsed;
+    offset_ = clock - now;
+    return clock;
+  }
+  if (!audioDone_ || offset_ == AV_NOPTS_VALUE) {
+    return AV_NOPTS_VALUE;
+  }
+  return now + offset_;
+}
+
+int Player::MediaPlayer::update() {
+  if (!playing_) {
+    return -1;
+  }
+  auto stream = demuxer_.stream(videoIndex_);
+  while (true) {
+    if (!pending_) {
+      if (!stream || (!videoFrames_.tryPop(pending_) && videoFrames_.finished())) {
+        // nothing more to show, wait for the audio to play out
+        if (audioDone_) {
+          close();
+          return -1;
+        }
+        return PLAYER_POLL_MS * 10;
+      }
+      if (!pending_) {
+        // the decoder is behind
+        return PLAYER_POLL_MS;
+      }
+      auto pts = timestamp(pending_, stream);
+      pendingPts_ = pts == AV_NOPTS_VALUE ? pendingPts_ + frameDuration_ : pts;
+    }
+
+    auto now = av_gettime_relative();
+    auto clock = this->clock();
+    if (clock == AV_NOPTS_VALUE) {
+      if (!audioDone_) {
+        // the audio hasn't started yet
+        return PLAYER_POLL_MS;
+      }
+      // no audio to follow, the first frame starts the clock
+      offset_ = pendingPts_ - now;
+      clock = pendingPts_;
+    }
+
+    auto diff = pendingPts_ - clock;
+    if (diff > 1000) {
+      return (int)std::min<int64_t>((diff + 999) / 1000, PLAYER_POLL_MS * 20);
+    }
+    auto lateness = -diff;
+    if (lateness > frameDuration_ && videoFrames_.size() > 0) {
+      // the next one is due already, catch up instead of showing this late
+      stats_.video.dropped++;
+      av_frame_free(&pending_);
+      continue;
+    }
+
+    stats_.drift.add(std::abs(diff));
+    stats_.video.lateness.add(std::max<int64_t>(lateness, 0));
+    if (lateness * 4 > frameDuration_) {
+      stats_.video.late++;
+    }
+    stats_.audioPackets.add(audioPackets_.size());
+    stats_.videoPackets.add(videoPackets_.size());
+    stats_.audioFrames.add(audioFrames_.size());
+    stats_.videoFrames.add(videoFrames_.size());
+    if (present(pending_)) {
+      render();
+      stats_.video.shown++;
+    }
+    av_frame_free(&pending_);
+  }
+}
+
+bool Player::MediaPlayer::present(AVFrame *frame) {
+  auto fmt = (AVPixelFormat)frame->format;
+  auto fit = Window::fit(frame->width, frame->height);
+  // 4:2:0 wants even sizes
+  int width = frame->width, height = frame->height;
+  bool shrink = width > fit.w || height > fit.h;
+  if (shrink) {
+    width = std::max(fit.w & ~1, 2);
+    height = std::max(fit.h & ~1, 2);
+  }
+
+  if (shrink || (fmt != AV_PIX_FMT_YUV420P && fmt != AV_PIX_FMT_YUVJ420P)) {
+    if (!converted_ || converted_->width != width || converted_->height != height) {
+      av_frame_free(&converted_);
+      converted_ = av_frame_alloc();
+      converted_->format = AV_PIX_FMT_YUV420P;
+      converted_->width = width;
+      converted_->height = height;
+      int ret = av_frame_get_buffer(converted_, 0);
+      if (ret < 0) {
+        log_error(ret);
+        av_frame_free(&converted_);
+        return false;
+      }
+    }
+    // the texture only gets what the window can show
+    bool converted = !shrink && convertFrame(frame, converted_);
+    if (!converted && !scaler_.scale(frame, converted_)) {
+      return false;
+    }
+    frame = converted_;
+  }
+
+  if (!texture_ || width_ != width || height_ != height) {
+    if (texture_) {
+      SDL_DestroyTexture(texture_);
+    }
+    width_ = width;
+    height_ = height;
+    texture_ = SDL_CreateTexture(renderer(), SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING,
+                                 width_, height_);
+    if (!texture_) {
+      av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+      return false;
+    }
+  }
+
+  // yuv420p goes up as is, the planes are copied straight out of the decoder's buffers
+  if (SDL_UpdateYUVTexture(texture_, nullptr, frame->data[0], frame->linesize[0], frame->data[1],
+                           frame->linesize[1], frame->data[2], frame->linesize[2])) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    return false;
+  }
+  return true;
+}
+
+void Player::MediaPlayer::render() {
+  ClearWhite();
+  auto dstRect = Window::fit(width_, height_);
+  if (SDL_RenderCopy(renderer(), texture_, nullptr, &dstRect)) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    return;
+  }
+  SDL_RenderPresent(renderer());
+}
@@ -0,0 +1,249 @@
+#include "Core/mixer.h"
+#include "Core/sink.h"
+#include "Core/source.h"
+#include "Utils/mix_kernels.h"
+
+#include <algorithm>
+#include <thread>
+
+Player::Mixer::Mixer() : ownSink_(new DeviceSink()), sink_(ownSink_.get()) {}
+
+Player::Mixer::Mixer(AudioSink *sink) : sink_(sink) {}
+
+Player::Mixer::~Mixer() { close(); }
+
+bool Player::Mixer::open(const SDL_AudioSpec &desired) {
+  std::lock_guard<std::mutex> guard(control_);
+  return openDevice(desired);
+}
+
+bool Player::Mixer::openDevice(const SDL_AudioSpec &desired) {
+  if (isOpen()) {
+    return true;
+  }
+  SDL_AudioSpec want = desired;
+  want.callback = callback;
+  want.userdata = this;
+  if (!sink_->open(want, spec_)) {
+    return false;
+  }
+  frameSize_ = (SDL_AUDIO_BITSIZE(spec_.format) >> 3) * spec_.channels;
+  lastCallback_ = {};
+  periodStart_ = 0;
+  periodDuration_ = 0;
+  scratch_.resize(spec_.size);
+  convert_.resize(spec_.size);
+  open_ = true;
+  return true;
+}
+
+void Player::Mixer::close() {
+  std::lock_guard<std::mutex> guard(control_);
+  if (!isOpen()) {
+    return;
+  }
+  sink_->close();
+  open_ = false;
+  for (auto &channel : channels_) {
+    SDL_FreeAudioStream(channel.stream);
+  }
+  channels_.clear();
+}
+
+int Player::Mixer::add(const std::shared_ptr<AudioSource> &source, float gain) {
+  // the first sources of several players may race to open the device
+  std::lock_guard<std::mutex> guard(control_);
+  if (!source || !openDevice(source->spec())) {
+    return 0;
+  }
+  Channel channel;
+  channel.source = source;
+  channel.gain = gain;
+  channel.applied = gain;
+  auto &spec = source->spec();
+  channel.frameSize = (SDL_AUDIO_BITSIZE(spec.format) >> 3) * spec.channels;
+  if (spec.format != spec_.format || spec.channels != spec_.channels || spec.freq != spec_.freq) {
+    channel.stream = SDL_NewAudioStream(spec.format, spec.channels, spec.freq, spec_.format,
+                                        spec_.channels, spec_.freq);
+    if (!channel.stream) {
+      av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+      return 0;
+    }
+  }
+
+  lock();
+  channel.id = nextId_++;
+  channels_.push_back(channel);
+  unlock();
+  sink_->pause(false);
+  return channel.id;
+}
+
+void Player::Mixer::remove(int id) {
+  std::lock_guard<std::mutex> guard(control_);
+  if (!isOpen()) {
+    return;
+  }
+  Channel channel;
+  lock();
+  auto it = std::find_if(channels_.begin(), channels_.end(),
+                         [id](const Channel &c) { return c.id == id; });
+  if (it != channels_.end()) {
+    channel = *it;
+    channels_.erase(it);
+  }
+  bool idle = channels_.empty();
+  unlock();
+
+  // don't keep the device spinning on silence
+  if (idle) {
+    sink_->pause(true);
+  }
+  SDL_FreeAudioStream(channel.stream);
+}
+
+void Player::Mixer::setGain(int id, float gain) {
+  lock();
+  for (auto &channel : channels_) {
+    if (channel.id == id) {
+      channel.gain = gain;
+    }
+  }
+  unlock();
+}
+
+void Player::Mixer::reposition(int id, const std::function<void()> &move) {
+  lock();
+  move();
+  for (auto &channel : channels_) {
+    if (channel.id == id && channel.stream) {
+      SDL_AudioStreamClear(channel.stream);
+    }
+  }
+  unlock();
+}
+
+Player::Mixer::Period Player::Mixer::period(const std::function<void()> &sample) const {
+  while (true) {
+    auto sequence = sequence_.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    Period period{periodStart_.load(std::memory_order_relaxed),
+                  periodDuration_.load(std::memory_order_relaxed)};
+    sample();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) == sequence) {
+      return period;
+    }
+  }
+}
+
+void Player::Mixer::callback(void *userdata, Byte *stream, int len) {
+  using namespace std::chrono;
+  auto mixer = static_cast<Mixer *>(userdata);
+  auto &stats = mixer->stats_;
+  mixer->sequence_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  auto start = av_gettime_relative();
+  auto begin = steady_clock::now();
+  if (mixer->lastCallback_.time_since_epoch().count()) {
+    auto period = microseconds((int64_t)mixer->spec_.samples * 1000000 / mixer->spec_.freq);
+    auto interval = duration_cast<microseconds>(begin - mixer->lastCallback_);
+    stats.jitter.add(std::abs((interval - period).count()));
+  }
+  mixer->lastCallback_ = begin;
+
+  mixer->sink_->filled(mixer->mix(stream, len));
+  auto duration = (int64_t)(len / mixer->frameSize_) * AV_TIME_BASE / mixer->spec_.freq;
+  mixer->periodStart_.store(start, std::memory_order_relaxed);
+  mixer->periodDuration_.store(duration, std::memory_order_relaxed);
+  mixer->sequence_.fetch_add(1, std::memory_order_release);
+
+  stats.callbacks.fetch_add(1, std::memory_order_relaxed);
+  stats.duration.add(duration_cast<microseconds>(steady_clock::now() - begin).count());
+}
+
+// s16 and f32 go through the vectorized kernels, anything else through SDL
+int Player::Mixer::mix(Byte *stream, int len) {
+  SDL_memset(stream, spec_.silence, len);
+  len = std::min(len, (int)scratch_.size());
+  auto &kernels = mixKernels();
+  bool underrun = false;
+  int filled = 0;
+  for (auto &channel : channels_) {
+    auto level = channel.source->fill();
+    if (level >= 0) {
+      stats_.fill.add(level);
+    }
+    int size = fill(channel, scratch_.data(), len);
+    if (size < len && !channel.source->finished()) {
+      underrun = true;
+    }
+    if (size < 1) {
+      continue;
+    }
+    filled = std::max(filled, size);
+    int frames = size / frameSize_;
+    auto step = (channel.gain - channel.applied) / (float)frames;
+    switch (spec_.format) {
+    case AUDIO_S16SYS:
+      kernels.mixS16(reinterpret_cast<int16_t *>(stream),
+                     reinterpret_cast<const int16_t *>(scratch_.data()), frames, spec_.channels,
+                     channel.applied, step);
+      break;
+    case AUDIO_F32SYS:
+      kernels.mixF32(reinterpret_cast<float *>(stream),
+                     reinterpret_cast<const float *>(scratch_.data()), frames, spec_.channels,
+                     channel.applied, step);
+      break;
+    default: {
+      auto volume = (int)(channel.gain * SDL_MIX_MAXVOLUME);
+      SDL_MixAudioFormat(stream, scratch_.data(), spec_.format, size,
+                         std::clamp(volume, 0, SDL_MIX_MAXVOLUME));
+      break;
+    }
+    }
+    channel.applied = channel.gain;
+  }
+  if (underrun) {
+    stats_.underruns.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (spec_.format == AUDIO_F32SYS) {
+    kernels.clipF32(reinterpret_cast<float *>(stream), len / (int)sizeof(float));
+  }
+  return filled;
+}
+
+int Player::Mixer::fill(Channel &channel, Byte *data, int len) {
+  if (!channel.stream) {
+    return channel.source->pull(data, len);
+  }
+  int chunk = (int)convert_.size() / channel.frameSize * channel.frameSize;
+  while (SDL_AudioStreamAvailable(channel.stream) < len) {
+    if (channel.source->finished()) {
+      SDL_AudioStreamFlush(channel.stream);
+      break;
+    }
+    int size = channel.source->pull(convert_.data(), chunk);
+    if (size < 1) {
+      // underrun, play what is converted so far
+      break;
+    }
+    SDL_AudioStreamPut(channel.stream, convert_.data(), size);
+  }
+  return SDL_AudioStreamGet(channel.stream, data, len);
+}
+
+void Player::Mixer::lock() {
+  if (isOpen()) {
+    sink_->lock();
+  }
+}
+
+void Player::Mixer::unlock() {
+  if (isOpen()) {
+    sink_->unlock();
+  }
+}
@@ -0,0 +1,142 @@
+#include "Core/muxer.h"
+
+#include <algorithm>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// 按码率预分配多少秒的文件空间
+#define MUXER_PREALLOCATE_SECONDS 10
+
+Player::Muxer::~Muxer() { close(); }
+
+bool Player::Muxer::open(const std::string &filename) {
+  close();
+  int ret = avformat_alloc_output_context2(&ctx_, nullptr, nullptr, filename.c_str());
+  if (ret < 0) {
+    log_error(ret);
+    return false;
+  }
+  filename_ = filename;
+  customIO_ = false;
+  timeBases_.clear();
+  queue_.reset();
+  return true;
+}
+
+bool Player::Muxer::open(AVIOContext *pb, const char *format) {
+  close();
+  int ret = avformat_alloc_output_context2(&ctx_, nullptr, format, nullptr);
+  if (ret < 0) {
+    log_error(ret);
+    return false;
+  }
+  ctx_->pb = pb;
+  filename_ = format ? format : "";
+  customIO_ = true;
+  timeBases_.clear();
+  queue_.reset();
+  return true;
+}
+
+bool Player::Muxer::globalHeader() const {
+  return ctx_ && (ctx_->oformat->flags & AVFMT_GLOBALHEADER);
+}
+
+int Player::Muxer::addStream(const AVCodecContext *ctx) {
+  if (!ctx_ || headerWritten_) {
+    return -1;
+  }
+  auto stream = avformat_new_stream(ctx_, nullptr);
+  if (!stream) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call avformat_new_stream");
+    return -1;
+  }
+  int ret = avcodec_parameters_from_context(stream->codecpar, ctx);
+  if (ret < 0) {
+    log_error(ret);
+    return -1;
+  }
+  stream->time_base = ctx->time_base;
+  timeBases_.push_back(ctx->time_base);
+  return stream->index;
+}
+
+bool Player::Muxer::start() {
+  if (!ctx_ || headerWritten_) {
+    return false;
+  }
+  if (!customIO_ && !(ctx_->oformat->flags & AVFMT_NOFILE)) {
+    int64_t bitRate = 0;
+    for (unsigned i = 0; i < ctx_->nb_streams; ++i) {
+      bitRate += std::max<int64_t>(ctx_->streams[i]->codecpar->bit_rate, 0);
+    }
+    if (!(ctx_->pb = file_.openWrite(filename_, bitRate / 8 * MUXER_PREALLOCATE_SECONDS))) {
+      return false;
+    }
+  }
+  AVDictionary *opts = nullptr;
+  auto extension = fs::path(filename_).extension().string();
+  if (extension == ".mp4" || extension == ".mov") {
+    av_dict_set(&opts, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+  }
+  int ret = avformat_write_header(ctx_, &opts);
+  av_dict_free(&opts);
+  if (ret < 0) {
+    log_error(ret);
+    return false;
+  }
+  headerWritten_ = true;
+  thread_ = std::thread(&Player::Muxer::run, this);
+  return true;
+}
+
+bool Player::Muxer::write(AVPacket *pkt) {
+  if (!headerWritten_ || pkt->stream_index < 0 ||
+      pkt->stream_index >= (int)timeBases_.size()) {
+    av_packet_free(&pkt);
+    return false;
+  }
+  if (!queue_.push(pkt)) {
+    av_packet_free(&pkt);
+    return false;
+  }
+  return true;
+}
+
+void Player::Muxer::run() {
+  AVPacket *pkt = nullptr;
+  while (queue_.pop(pkt)) {
+    auto stream = ctx_->streams[pkt->stream_index];
+    // the header may have changed the stream's time base
+    av_packet_rescale_ts(pkt, timeBases_[pkt->stream_index], stream->time_base);
+    int ret = av_interleaved_write_frame(ctx_, pkt);
+    av_packet_free(&pkt);
+    if (ret < 0) {
+      log_error(ret);
+      queue_.abort();
+      break;
+    }
+  }
+}
+
+void Player::Muxer::abort() { queue_.abort(); }
+
+void Player::Muxer::close() {
+  queue_.finish();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (headerWritten_) {
+    av_write_trailer(ctx_);
+    headerWritten_ = false;
+  }
+  if (customIO_ && ctx_) {
+    avio_flush(ctx_->pb);
+  } else if (ctx_) {
+    ctx_->pb = nullptr;
+  }
+  file_.close();
+  avformat_free_context(ctx_);
+  ctx_ = nullptr;
+}
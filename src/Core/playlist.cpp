@@ -0,0 +1,113 @@
+#include "Core/playlist.h"
+
+// 同时排队或等待回收的条目上限
+#define PLAYLIST_SLOTS 16
+
+Player::Playlist::Playlist(const SDL_AudioSpec &spec)
+    : AudioSource(spec), frameSize_((SDL_AUDIO_BITSIZE(spec.format) >> 3) * spec.channels),
+      incoming_(PLAYLIST_SLOTS), retired_(PLAYLIST_SLOTS) {}
+
+Player::Playlist::~Playlist() {
+  collect();
+  release(current_);
+  Item *item = nullptr;
+  while (incoming_.pop(item)) {
+    release(item);
+  }
+}
+
+bool Player::Playlist::append(const std::shared_ptr<AudioSource> &source) {
+  if (!source) {
+    return false;
+  }
+  collect();
+  if (live_ >= incoming_.capacity()) {
+    av_log(nullptr, AV_LOG_ERROR, "Playlist is full\n");
+    return false;
+  }
+  auto item = new Item;
+  item->source = source;
+  auto &spec = source->spec();
+  item->frameSize = (SDL_AUDIO_BITSIZE(spec.format) >> 3) * spec.channels;
+  if (spec.format != spec_.format || spec.channels != spec_.channels || spec.freq != spec_.freq) {
+    item->stream = SDL_NewAudioStream(spec.format, spec.channels, spec.freq, spec_.format,
+                                      spec_.channels, spec_.freq);
+    if (!item->stream) {
+      av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+      delete item;
+      return false;
+    }
+    // the audio thread must not allocate
+    item->convert.resize((size_t)spec.samples * item->frameSize);
+  }
+
+  live_++;
+  queued_++;
+  // can't be full, live_ counts everything in either queue
+  incoming_.push(item);
+  return true;
+}
+
+int Player::Playlist::pull(Byte *stream, int len) {
+  int total = 0;
+  while (total < len) {
+    if (!current_ && !incoming_.pop(current_)) {
+      break;
+    }
+    auto &item = *current_;
+    total += read(item, stream + total, len - total);
+    if (total == len || !item.source->finished() ||
+        (item.stream && SDL_AudioStreamAvailable(item.stream) > 0)) {
+      // full, or an underrun of the current item
+      break;
+    }
+    // a truncated last frame must not shift the channels of the next item
+    auto pad = std::min((frameSize_ - total % frameSize_) % frameSize_, len - total);
+    SDL_memset(stream + total, spec_.silence, pad);
+    total += pad;
+    retired_.push(current_);
+    current_ = nullptr;
+    queued_--;
+  }
+  return total;
+}
+
+int Player::Playlist::read(Item &item, Byte *stream, int len) {
+  if (!item.stream) {
+    return item.source->pull(stream, len);
+  }
+  int chunk = (int)item.convert.size() / item.frameSize * item.frameSize;
+  while (SDL_AudioStreamAvailable(item.stream) < len) {
+    if (item.source->finished()) {
+      SDL_AudioStreamFlush(item.stream);
+      break;
+    }
+    int size = item.source->pull(item.convert.data(), chunk);
+    if (size < 1) {
+      break;
+    }
+    SDL_AudioStreamPut(item.stream, item.convert.data(), size);
+  }
+  return std::max(0, SDL_AudioStreamGet(item.stream, stream, len));
+}
+
+bool Player::Playlist::finished() const { return queued_ == 0; }
+
+int Player::Playlist::fill() const { return current_ ? current_->source->fill() : -1; }
+
+size_t Player::Playlist::size() const { return queued_; }
+
+void Player::Playlist::collect() {
+  Item *item = nullptr;
+  while (retired_.pop(item)) {
+    release(item);
+    live_--;
+  }
+}
+
+void Player::Playlist::release(Item *item) {
+  if (item) {
+    SDL_FreeAudioStream(item->stream);
+    delete item;
+  }
+}
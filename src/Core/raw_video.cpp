@@ -0,0 +1,253 @@
+#include "Core/raw_video.h"
+#include "GUI/window.h"
+
+#include <cmath>
+
+// 提前映射的帧数
+#define RAW_VIDEO_PREFETCH_FRAMES 4
+
+Player::RawVideo::~RawVideo() { close(); }
+
+bool Player::RawVideo::open(const std::string &filename, int width, int height, double frameRate,
+                            uint32_t format) {
+  close();
+  planeCount_ = planes(format, width, height, planes_);
+  frameSize_ = frameSize(format, width, height);
+  if (!frameSize_ || frameRate <= 0) {
+    av_log(nullptr, AV_LOG_ERROR, "Unsupported raw video %dx%d@%.2f\n", width, height, frameRate);
+    return false;
+  }
+  size_t size;
+  if (map_.open(filename)) {
+    size = map_.size();
+  } else if (input_.open(filename)) {
+    size = input_.size();
+  } else {
+    return false;
+  }
+  texture_ = SDL_CreateTexture(renderer(), format, SDL_TEXTUREACCESS_STREAMING, width, height);
+  if (!texture_) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    close();
+    return false;
+  }
+  format_ = format;
+  width_ = width;
+  height_ = height;
+  frameRate_ = frameRate;
+  frames_ = (int64_t)(size / frameSize_);
+  if (size % frameSize_) {
+    av_log(nullptr, AV_LOG_WARNING, "%s ends with a partial frame\n", filename.c_str());
+  }
+  next_ = 0;
+  start_ = 0;
+  stats_.reset();
+  return frames_ > 0;
+}
+
+bool Player::RawVideo::open(const std::string &filename) {
+  std::ifstream input(sidecar(filename));
+  int width = 0, height = 0, num = 0, den = 0;
+  std::string name;
+  if (!(input >> width >> height >> num >> den >> name) || num < 1 || den < 1) {
+    av_log(nullptr, AV_LOG_ERROR, "No capture settings for %s\n", filename.c_str());
+    return false;
+  }
+  auto format = sdlFormat(av_get_pix_fmt(name.c_str()));
+  if (format == SDL_PIXELFORMAT_UNKNOWN) {
+    av_log(nullptr, AV_LOG_ERROR, "Can't play %s frames\n", name.c_str());
+    return false;
+  }
+  return open(filename, width, height, (double)num / den, format);
+}
+
+bool Player::RawVideo::describe(const std::string &filename, int width, int height,
+                                AVRational frameRate, AVPixelFormat format) {
+  auto name = av_get_pix_fmt_name(format);
+  std::ofstream output(sidecar(filename));
+  if (!name || !output.is_open()) {
+    return false;
+  }
+  output << width << ' ' << height << ' ' << frameRate.num << ' ' << frameRate.den << ' ' << name
+         << '\n';
+  return output.good();
+}
+
+void Player::RawVideo::close() {
+  if (stats_.shown || stats_.dropped) {
+    stats_.dump();
+  }
+  stats_.reset();
+  if (texture_) {
+    SDL_DestroyTexture(texture_);
+    texture_ = nullptr;
+  }
+  map_.close();
+  input_.close();
+  frames_ = 0;
+}
+
+int64_t Player::RawVideo::slot(int64_t index) const {
+  return start_ + (int64_t)std::llround(index * 1000000.0 / frameRate_);
+}
+
+int Player::RawVideo::update() {
+  if (!playing()) {
+    return -1;
+  }
+  auto now = av_gettime_relative();
+  if (!start_) {
+    start_ = now;
+  }
+  if (now < slot(next_)) {
+    return (int)((slot(next_) - now + 999) / 1000);
+  }
+  // the newest frame whose slot has started
+  auto due = std::max(next_, (int64_t)((now - start_) * frameRate_ / 1000000));
+  if (due >= frames_) {
+    stats_.dropped += frames_ - next_;
+    close();
+    return -1;
+  }
+  // against the frame going up, the skipped ones are counted as dropped only
+  auto lateness = std::max<int64_t>(now - slot(due), 0);
+  stats_.dropped += due - next_;
+  stats_.lateness.add(lateness);
+  if (lateness * frameRate_ > 250000) {
+    stats_.late++;
+  }
+  if (upload(due)) {
+    render();
+    stats_.shown++;
+  }
+  next_ = due + 1;
+  if (next_ >= frames_) {
+    close();
+    return -1;
+  }
+  now = av_gettime_relative();
+  return (int)std::max<int64_t>((slot(next_) - now + 999) / 1000, 0);
+}
+
+bool Player::RawVideo::upload(int64_t index) {
+  void *pixels;
+  int pitch;
+  if (SDL_LockTexture(texture_, nullptr, &pixels, &pitch)) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    return false;
+  }
+  auto offset = (size_t)index * frameSize_;
+  const Byte *src;
+  if (map_.isOpen()) {
+    map_.seek(offset + frameSize_);
+    map_.prefetch(frameSize_ * RAW_VIDEO_PREFETCH_FRAMES);
+    src = map_.data() + offset;
+  } else {
+    if (input_.tell() != (int64_t)offset) {
+      input_.seek((int64_t)offset);
+    }
+    if (pitch == planes_[0].pitch) {
+      // same layout as the file, read right into the texture
+      auto len = input_.read(pixels, frameSize_);
+      SDL_UnlockTexture(texture_);
+      return len == frameSize_;
+    }
+    scratch_.resize(frameSize_);
+    if (input_.read(scratch_.data(), frameSize_) != frameSize_) {
+      SDL_UnlockTexture(texture_);
+      return false;
+    }
+    src = scratch_.data();
+  }
+
+  auto dst = static_cast<Byte *>(pixels);
+  for (int i = 0; i < planeCount_; ++i) {
+    auto &plane = planes_[i];
+    // the texture's chroma rows are derived from its luma pitch like the file's are
+    auto dstPitch = i == 0 ? pitch : planeCount_ == 3 ? (pitch + 1) / 2 : (pitch + 1) / 2 * 2;
+    if (dstPitch == plane.pitch) {
+      memcpy(dst, src, (size_t)plane.pitch * plane.rows);
+    } else {
+      for (int row = 0; row < plane.rows; ++row) {
+        memcpy(dst + (size_t)row * dstPitch, src + (size_t)row * plane.pitch, plane.pitch);
+      }
+    }
+    src += (size_t)plane.pitch * plane.rows;
+    dst += (size_t)dstPitch * plane.rows;
+  }
+  SDL_UnlockTexture(texture_);
+  return true;
+}
+
+void Player::RawVideo::render() {
+  ClearWhite();
+  auto dstRect = Window::fit(width_, height_);
+  if (SDL_RenderCopy(renderer(), texture_, nullptr, &dstRect)) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    return;
+  }
+  SDL_RenderPresent(renderer());
+}
+
+std::string Player::RawVideo::sidecar(const std::string &filename) { return filename + ".info"; }
+
+uint32_t Player::RawVideo::sdlFormat(AVPixelFormat format) {
+  switch (format) {
+  case AV_PIX_FMT_YUV420P:
+    return SDL_PIXELFORMAT_IYUV;
+  case AV_PIX_FMT_NV12:
+    return SDL_PIXELFORMAT_NV12;
+  case AV_PIX_FMT_NV21:
+    return SDL_PIXELFORMAT_NV21;
+  case AV_PIX_FMT_YUYV422:
+    return SDL_PIXELFORMAT_YUY2;
+  case AV_PIX_FMT_UYVY422:
+    return SDL_PIXELFORMAT_UYVY;
+  case AV_PIX_FMT_YVYU422:
+    return SDL_PIXELFORMAT_YVYU;
+  default:
+    return SDL_PIXELFORMAT_UNKNOWN;
+  }
+}
+
+int Player::RawVideo::planes(uint32_t format, int width, int height, Plane *planes) {
+  auto chromaWidth = (width + 1) / 2;
+  auto chromaHeight = (height + 1) / 2;
+  switch (format) {
+  case SDL_PIXELFORMAT_IYUV:
+  case SDL_PIXELFORMAT_YV12:
+    planes[0] = {width, height};
+    planes[1] = {chromaWidth, chromaHeight};
+    planes[2] = {chromaWidth, chromaHeight};
+    return 3;
+  case SDL_PIXELFORMAT_NV12:
+  case SDL_PIXELFORMAT_NV21:
+    planes[0] = {width, height};
+    planes[1] = {chromaWidth * 2, chromaHeight};
+    return 2;
+  case SDL_PIXELFORMAT_YUY2:
+  case SDL_PIXELFORMAT_UYVY:
+  case SDL_PIXELFORMAT_YVYU:
+    planes[0] = {chromaWidth * 4, height};
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+size_t Player::RawVideo::frameSize(uint32_t format, int width, int height) {
+  if (width < 1 || height < 1) {
+    return 0;
+  }
+  Plane planes[3];
+  size_t size = 0;
+  for (int i = 0, n = RawVideo::planes(format, width, height, planes); i < n; ++i) {
+    size += (size_t)planes[i].pitch * planes[i].rows;
+  }
+  return size;
+}
+
+int Player::RawVideo::pitch(uint32_t format, int width) {
+  Plane planes[3];
+  return RawVideo::planes(format, width, 1, planes) ? planes[0].pitch : 0;
+}
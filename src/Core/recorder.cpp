@@ -1,17 +1,167 @@
 #include "Core/recorder.h"
+#include "Core/audio_encoder.h"
+#include "Core/audio_pipeline.h"
+#include "Core/muxer.h"
+#include "Core/raw_video.h"
+#include "Core/video_encoder.h"
+#include "Utils/file_avio.h"
+#include "Utils/file_io.h"
 #include "Utils/header.h"
 #include "Utils/spec.h"
+#include "Utils/thread_pool.h"
 
-#include <fstream>
-#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <numeric>
 #include <thread>
+#include <vector>
+
+// 并行重采样：每块约 4 秒输入，前后各多读的帧数至少这么多，降采样时按滤波器长度放大
+#define RESAMPLE_CHUNK_SECONDS 4
+#define RESAMPLE_OVERLAP 256
+
+// PCM 转 AAC 时每次读入的样本数
+#define AAC_READ_SAMPLES 4096
+
+// 录制文件预先分配的时长，停止时截掉没用完的部分
+#define RECORD_PREALLOCATE_SECONDS 10
 
 namespace fs = std::filesystem;
 
-[[maybe_unused]] Player::Recorder::Recorder(const std::string &filename) { setFilename(filename); }
+// 按每像素位数从小到大，越小采集和写盘越便宜
+static const AVPixelFormat pixelFormats[] = {AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P,
+                                             AV_PIX_FMT_YUYV422, AV_PIX_FMT_UYVY422,
+                                             AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR0};
+
+// bytes the device delivers in RECORD_PREALLOCATE_SECONDS, 0 when that can't be told
+static int64_t preallocation(AVFormatContext *ctx) {
+  auto stream = ctx->streams[0];
+  auto params = stream->codecpar;
+  int64_t rate = 0;
+  if (params->codec_type == AVMEDIA_TYPE_AUDIO) {
+    rate = (int64_t)params->sample_rate * params->ch_layout.nb_channels *
+           std::max(av_get_bits_per_sample(params->codec_id) >> 3, 1);
+  } else if (params->codec_type == AVMEDIA_TYPE_VIDEO) {
+    auto frameRate = av_guess_frame_rate(ctx, stream, nullptr);
+    auto size = av_image_get_buffer_size((AVPixelFormat)params->format, params->width,
+                                         params->height, 1);
+    if (frameRate.num > 0 && frameRate.den > 0 && size > 0) {
+      rate = (int64_t)size * frameRate.num / frameRate.den;
+    }
+  }
+  return rate * RECORD_PREALLOCATE_SECONDS;
+}
+
+static std::string env(const char *name) {
+  auto value = getenv(name);
+  return value ? value : "";
+}
+
+Player::Recorder::Recorder() {
+  auto backend = env("PLAYER_AUDIO_BACKEND");
+  setAudioDevice(backend.empty() ? FMT_NAME : backend, env("PLAYER_AUDIO_DEVICE"));
+  backend = env("PLAYER_VIDEO_BACKEND");
+  setVideoDevice(backend.empty() ? VIDEO_FMT_NAME : backend, env("PLAYER_VIDEO_DEVICE"));
+}
+
+[[maybe_unused]] Player::Recorder::Recorder(const std::string &filename) : Recorder() {
+  setFilename(filename);
+}
+
+void Player::Recorder::setAudioDevice(const std::string &backend, const std::string &name) {
+  audioDevice_ = {backend, name.empty() ? defaultName(backend, AVMEDIA_TYPE_AUDIO) : name};
+}
+
+void Player::Recorder::setVideoDevice(const std::string &backend, const std::string &name) {
+  videoDevice_ = {backend, name.empty() ? defaultName(backend, AVMEDIA_TYPE_VIDEO) : name};
+}
+
+std::string Player::Recorder::defaultName(const std::string &backend, AVMediaType type) {
+  bool video = type == AVMEDIA_TYPE_VIDEO;
+  if (backend == "lavfi") {
+    return video ? "testsrc2=size=640x480:rate=30" : "sine=frequency=440:sample_rate=48000";
+  }
+  if (backend == "alsa" || backend == "pulse") {
+    return "default";
+  }
+  if (backend == "v4l2") {
+    return "/dev/video0";
+  }
+  return video ? VIDEO_DEVICE_NAME : AUDIO_DEVICE_NAME;
+}
+
+bool Player::Recorder::openDevice(AVMediaType type, AVDictionary **opts) {
+  bool video = type == AVMEDIA_TYPE_VIDEO;
+  auto &device = video ? videoDevice_ : audioDevice_;
+  // lavfi sources have no pixel format to choose
+  if (video && device.backend != "lavfi") {
+    if (!negotiate(device, opts)) {
+      return false;
+    }
+  } else if (!openDevice(device.name.c_str(), opts, device.backend.c_str())) {
+    return false;
+  }
+
+  auto params = context()->streams[0]->codecpar;
+  if (video) {
+    av_log(nullptr, AV_LOG_INFO, "%s %s: %dx%d %s\n", device.backend.c_str(),
+           device.name.c_str(), params->width, params->height,
+           av_get_pix_fmt_name((AVPixelFormat)params->format));
+    return true;
+  }
+  // capture devices hand out native PCM, follow whatever this one delivers
+  switch (params->codec_id) {
+  case AV_CODEC_ID_PCM_F32LE:
+    fmt_ = FmtFlt;
+    break;
+  case AV_CODEC_ID_PCM_S16LE:
+    fmt_ = FmtS16;
+    break;
+  default:
+    break;
+  }
+  av_log(nullptr, AV_LOG_INFO, "%s %s: %d Hz %d channels %s\n", device.backend.c_str(),
+         device.name.c_str(), params->sample_rate, params->ch_layout.nb_channels,
+         av_get_sample_fmt_name(static_cast<AVSampleFormat>(fmt_)));
+  return true;
+}
+
+bool Player::Recorder::negotiate(const Device &device, AVDictionary **opts) {
+  // v4l2 calls it input_format, dshow and avfoundation pixel_format
+  auto key = device.backend == "v4l2" ? "input_format" : "pixel_format";
+  if (opts && av_dict_get(*opts, key, nullptr, 0)) {
+    // the caller insists on one
+    return openDevice(device.name.c_str(), opts, device.backend.c_str());
+  }
+  auto fmt = av_find_input_format(device.backend.c_str());
+  if (!fmt) {
+    av_log(nullptr, AV_LOG_ERROR, "Failed to find input format %s\n", device.backend.c_str());
+    return false;
+  }
+  for (auto pixelFormat : pixelFormats) {
+    AVDictionary *candidate = nullptr;
+    if (opts) {
+      av_dict_copy(&candidate, *opts, 0);
+    }
+    av_dict_set(&candidate, key, av_get_pix_fmt_name(pixelFormat), 0);
+    if (avformat_open_input(&ctx_, device.name.c_str(), fmt, &candidate) == 0) {
+      if (opts) {
+        av_dict_free(opts);
+        *opts = candidate;
+      } else {
+        av_dict_free(&candidate);
+      }
+      return true;
+    }
+    av_dict_free(&candidate);
+  }
+  // none of ours, let the device pick
+  return openDevice(device.name.c_str(), opts, device.backend.c_str());
+}
 
-bool Player::Recorder::openDevice(const char *device, AVDictionary **opts) {
-  auto fmt = av_find_input_format(FMT_NAME);
+bool Player::Recorder::openDevice(const char *device, AVDictionary **opts, const char *backend) {
+  auto fmt = av_find_input_format(backend);
   if (!fmt) {
     av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call av_find_input_format");
     return false;
@@ -41,36 +191,69 @@ void Player::Recorder::writePCM() {
     return;
   }
 
-  std::ofstream file;
-  file.open(filename(), std::ios::binary);
-  if (!file.is_open()) {
-    return;
-  }
-  auto pkt = av_packet_alloc();
-  if (!pkt) {
-    goto end;
+  recording_ = openDevice(AVMEDIA_TYPE_AUDIO);
+  FileWriter file;
+  if (recording_ && file.open(filename(), preallocation(context()))) {
+    capture(
+        context(), [&file](const AVPacket *pkt) { file.write(pkt->data, pkt->size); }, 256);
   }
+
+  file.close();
+  closeDevice();
+  stop();
+}
+
+bool Player::Recorder::capture(AVFormatContext *input, const PacketWriter::Write &write,
+                               size_t capacity, FrameDecimator *decimator, CaptureClock *clock) {
+  // dropped audio splices the recording without a gap, and the decimator already thins video
+  // evenly, dropping from a full queue on top of it would punch random holes back in
+  bool audio = input->streams[0]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO;
+  auto overflow = overflow_.value_or(audio || decimator ? Overflow::Block : Overflow::DropOldest);
+  CaptureQueue queue(queueCapacity_ ? queueCapacity_ : capacity, overflow);
+  PacketWriter writer(queue);
+  writer.start(write);
+  CaptureClock::Anchor anchor;
+  bool success = true;
   int ret;
-  recording_ = openDevice(AUDIO_DEVICE_NAME);
   while (recording_) {
-    ret = av_read_frame(context(), pkt);
+    auto pkt = av_packet_alloc();
+    if (!pkt) {
+      av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call av_packet_alloc");
+      success = false;
+      break;
+    }
+    ret = av_read_frame(input, pkt);
     if (ret == 0) {
-      file.write(reinterpret_cast<const char *>(pkt->data), pkt->size);
-      av_packet_unref(pkt);
-    } else if (ret == AVERROR(EAGAIN)) {
+      if (clock) {
+        clock->stamp(anchor, pkt, input->streams[pkt->stream_index]->time_base);
+      }
+      if (decimator && !decimator->keep(queue.size(), queue.capacity())) {
+        av_packet_free(&pkt);
+        continue;
+      }
+      // the packet is ref-counted, the writer frees it
+      queue.offer(pkt);
+      continue;
+    }
+    av_packet_free(&pkt);
+    if (ret == AVERROR(EAGAIN)) {
       continue;
-    } else {
-      log_error(ret);
-      goto end;
     }
+    log_error(ret);
+    success = false;
+    break;
   }
+  queue.finish();
+  writer.stop();
 
-end:
-  file.flush();
-  file.close();
-  av_packet_free(&pkt);
-  closeDevice();
-  stop();
+  av_log(nullptr, AV_LOG_INFO, "%s:\n", filename().c_str());
+  queue.stats().dump();
+  return success;
+}
+
+void Player::Recorder::setOverflow(Overflow overflow, size_t capacity) {
+  overflow_ = overflow;
+  queueCapacity_ = capacity;
 }
 
 void Player::Recorder::stop() { recording_ = false; }
@@ -83,26 +266,26 @@ AVFormatContext *Player::Recorder::context() { return ctx_; }
 
 void Player::Recorder::pcm2Wav(Header &header, const std::string &pcmFilename,
                                const std::string &wavFilename) {
-  std::ifstream pcm(pcmFilename, std::ios::binary);
-  if (!pcm.is_open()) {
+  FileReader pcm;
+  if (!pcm.open(pcmFilename)) {
     return;
   }
   header.chunkSize =
       header.dataSize + sizeof(Header) - sizeof(header.chunkID) - sizeof(header.chunkSize);
 
-  std::ofstream wav(wavFilename, std::ios::binary);
-  if (!wav.is_open()) {
+  FileWriter wav;
+  if (!wav.open(wavFilename, (int64_t)sizeof(Header) + pcm.size())) {
     return;
   }
 
-  wav.write(reinterpret_cast<const char *>(&header), sizeof(Header));
-  char buffer[1024];
+  wav.write(&header, sizeof(Header));
+  // both sides buffer whole blocks, this only has to be big enough not to show up in a profile
+  std::vector<Byte> buffer(IOBlock::Size);
   size_t size;
-  while ((size = pcm.read(buffer, (int)sizeof(buffer)).gcount()) > 0) {
-    wav.write(buffer, (int)size);
+  while ((size = pcm.read(buffer.data(), buffer.size())) > 0) {
+    wav.write(buffer.data(), size);
   }
 
-  wav.flush();
   wav.close();
   pcm.close();
 }
@@ -121,67 +304,92 @@ void Player::Recorder::writeWAV() {
     return;
   }
 
-  std::ofstream file;
-  file.open(filename(), std::ios::binary);
-  if (!file.is_open()) {
-    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to open file");
+  recording_ = openDevice(AVMEDIA_TYPE_AUDIO);
+  if (!recording_) {
+    return;
+  }
+  FileWriter file;
+  if (!file.open(filename(), (int64_t)sizeof(Header) + preallocation(context()))) {
+    closeDevice();
+    stop();
     return;
   }
-
-  recording_ = openDevice(AUDIO_DEVICE_NAME);
   Spec spec(context());
   Header header(spec);
-  fs::path f(filename());
-  file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
-  int ret;
-  auto pkt = av_packet_alloc();
-  if (!pkt) {
-    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call av_packet_alloc");
-    goto end;
-  }
-  while (recording_) {
-    ret = av_read_frame(context(), pkt);
-    if (ret == 0) {
-      file.write(reinterpret_cast<const char *>(pkt->data), pkt->size);
-      header.dataSize += pkt->size;
-      auto ms = 1000.0 * header.dataSize / header.byteRate;
-      std::cout << ms << std::endl;
-      av_packet_unref(pkt);
-    } else if (ret == AVERROR(EAGAIN)) {
-      continue;
-    } else {
-      log_error(ret);
-      goto end;
-    }
-  }
-  file.seekp(sizeof(Header) - sizeof(header.dataSize));
-  file.write(reinterpret_cast<const char *>(&header.dataSize), sizeof(header.dataSize));
-  header.chunkSize = file_size(f) - sizeof(header.chunkID) - sizeof(header.chunkSize);
-  file.seekp(sizeof(header.chunkID));
-  file.write(reinterpret_cast<const char *>(&header.chunkSize), sizeof(header.chunkSize));
+  file.write(&header, sizeof(Header));
+  capture(
+      context(),
+      [&](const AVPacket *pkt) {
+        file.write(pkt->data, pkt->size);
+        header.dataSize += pkt->size;
+        av_log(nullptr, AV_LOG_DEBUG, "%.0f ms recorded\n",
+               1000.0 * header.dataSize / header.byteRate);
+      },
+      256);
+  file.writeAt(sizeof(Header) - sizeof(header.dataSize), &header.dataSize,
+               sizeof(header.dataSize));
+  header.chunkSize = file.size() - sizeof(header.chunkID) - sizeof(header.chunkSize);
+  file.writeAt(sizeof(header.chunkID), &header.chunkSize, sizeof(header.chunkSize));
 
-end:
-  file.flush();
   file.close();
-  av_packet_free(&pkt);
   stop();
   closeDevice();
 }
 
+// ffmpeg -f avfoundation -i :1 -ar 44100 -ac 2 -c:a libfdk_aac out.aac
+void Player::Recorder::recordAAC() {
+  if (recording_) {
+    stop();
+    return;
+  }
+  std::thread writeThread(&Player::Recorder::writeAAC, this);
+  writeThread.detach();
+}
+
+void Player::Recorder::writeAAC() {
+  if (filename().empty()) {
+    return;
+  }
+
+  recording_ = openDevice(AVMEDIA_TYPE_AUDIO);
+  if (!recording_) {
+    return;
+  }
+  // .aac gets the adts muxer
+  Muxer muxer;
+  AudioEncoder encoder;
+  if (muxer.open(filename()) &&
+      encoder.open(muxer, context()->streams[0]->codecpar, static_cast<AVSampleFormat>(fmt_)) &&
+      muxer.start()) {
+    // the writer thread resamples and encodes, the device thread only reads
+    CaptureClock clock;
+    capture(
+        context(),
+        [this, &encoder](const AVPacket *pkt) {
+          if (!encoder.encode(pkt)) {
+            stop();
+          }
+        },
+        256, nullptr, &clock);
+    encoder.close();
+  }
+  muxer.close();
+  closeDevice();
+  stop();
+}
+
 void Player::Recorder::resample(const std::string &inputName, int inputSampleRate,
                                 AVSampleFormat inputFmt, AVChannelLayout inputChLayout,
                                 const std::string &outputName, int outputSampleRate,
                                 AVSampleFormat outputFmt, AVChannelLayout outputChLayout) {
-  std::ifstream input;
-  std::ofstream output;
+  FileReader input;
+  FileWriter output;
 
-  input.open(inputName, std::ios::binary);
-  if (!input.is_open()) {
+  if (!input.open(inputName)) {
     return;
   }
 
-  output.open(outputName, std::ios::binary);
-  if (!output.is_open()) {
+  if (!output.open(outputName)) {
     return;
   }
 
@@ -227,7 +435,7 @@ void Player::Recorder::resample(const std::string &inputName, int inputSampleRat
     goto end;
   }
 
-  while ((len = (int)input.read((char *)inputData[0], inputLinesize).gcount()) > 0) {
+  while ((len = (int)input.read(inputData[0], inputLinesize)) > 0) {
     inputSamples = len / inputBytesPerSample;
     ret = swr_convert(ctx, outputData, outputSamples, (const uint8_t **)inputData, inputSamples);
     if (ret < 0) {
@@ -236,12 +444,12 @@ void Player::Recorder::resample(const std::string &inputName, int inputSampleRat
     }
 
     int size = av_samples_get_buffer_size(nullptr, outputChannels, ret, outputFmt, 1);
-    output.write((char *)outputData[0], size);
+    output.write(outputData[0], size);
   }
 
   while ((ret = swr_convert(ctx, outputData, outputSamples, nullptr, 0)) > 0) {
     int size = av_samples_get_buffer_size(nullptr, outputChannels, ret, outputFmt, 1);
-    output.write((char *)outputData[0], size);
+    output.write(outputData[0], size);
   }
 
 end:
@@ -267,6 +475,177 @@ void Player::Recorder::resample(Player::ResampleAudioSpec &input,
            output.sampleRate, output.fmt, output.channelLayout);
 }
 
+// input frames of history the resampler's filter needs before an output sample comes out right
+static int64_t resampleOverlap(const Player::ResampleAudioSpec &input,
+                               const Player::ResampleAudioSpec &output) {
+  int64_t filterSize = 32;
+  double cutoff = 0.97;
+  auto swr = swr_alloc();
+  if (swr) {
+    av_opt_get_int(swr, "filter_size", 0, &filterSize);
+    av_opt_get_double(swr, "cutoff", 0, &cutoff);
+    swr_free(&swr);
+  }
+  // the taps are counted at the lower of the two rates, decimating stretches them over the input
+  auto ratio = std::max(1.0, (double)input.sampleRate / output.sampleRate);
+  auto taps = (int64_t)std::ceil((double)filterSize * ratio / std::max(cutoff, 0.01));
+  return std::max<int64_t>(RESAMPLE_OVERLAP, taps * 2);
+}
+
+bool Player::Recorder::resampleParallel(const ResampleAudioSpec &input,
+                                        const ResampleAudioSpec &output, int threads) {
+  FileWriter file;
+  if (!file.open(output.filename)) {
+    return false;
+  }
+  return resampleParallel(
+      input, output, [&file](const Byte *data, size_t len) { return file.write(data, len); },
+      threads);
+}
+
+bool Player::Recorder::resampleParallel(const ResampleAudioSpec &input,
+                                        const ResampleAudioSpec &output,
+                                        const ChunkHandler &onChunk, int threads) {
+  int inputFrameSize = input.channelLayout.nb_channels * av_get_bytes_per_sample(input.fmt);
+  std::error_code ec;
+  auto size = fs::file_size(input.filename, ec);
+  if (ec || inputFrameSize < 1 || size < (uintmax_t)inputFrameSize) {
+    av_log(nullptr, AV_LOG_ERROR, "Failed to read %s\n", input.filename.c_str());
+    return false;
+  }
+  auto total = (int64_t)(size / inputFrameSize);
+
+  // every multiple of `step` input frames maps onto a whole output frame
+  int64_t step = input.sampleRate / std::gcd(input.sampleRate, output.sampleRate);
+  auto align = [step](int64_t frames) { return (frames + step - 1) / step * step; };
+  auto overlap = align(resampleOverlap(input, output));
+  auto chunk = std::max(align((int64_t)input.sampleRate * RESAMPLE_CHUNK_SECONDS), overlap);
+
+  struct Chunk {
+    std::vector<Byte> data;
+    bool success = false;
+    std::future<void> done;
+  };
+  // outlives the pool, the workers fill its entries in place
+  std::deque<Chunk> pending;
+  bool success = true;
+  size_t chunks = 0;
+  auto begin = av_gettime_relative();
+  {
+    ThreadPool pool(threads);
+    // a few chunks in flight per worker, the rest of the file isn't read yet
+    auto window = pool.size() * 2;
+    auto deliver = [&] {
+      auto &front = pending.front();
+      front.done.wait();
+      bool ok = front.success && onChunk(front.data.data(), front.data.size());
+      pending.pop_front();
+      return ok;
+    };
+    for (int64_t start = 0; success && start < total; start += chunk) {
+      if (pending.size() >= window && !(success = deliver())) {
+        break;
+      }
+      auto end = std::min(start + chunk, total);
+      auto &next = pending.emplace_back();
+      next.done = pool.submit([&input, &output, &next, start, end, total, overlap] {
+        next.success = resampleChunk(input, output, start, end, total, overlap, next.data);
+      });
+      chunks++;
+    }
+    while (success && !pending.empty()) {
+      success = deliver();
+    }
+    for (auto &rest : pending) {
+      rest.done.wait();
+    }
+    auto elapsed = (double)(av_gettime_relative() - begin) / AV_TIME_BASE;
+    av_log(nullptr, AV_LOG_INFO, "Resampled %.2fs of audio in %zu chunks on %zu threads in %.2fs\n",
+           (double)total / input.sampleRate, chunks, pool.size(), elapsed);
+  }
+  return success;
+}
+
+bool Player::Recorder::resampleChunk(const ResampleAudioSpec &input,
+                                     const ResampleAudioSpec &output, int64_t begin, int64_t end,
+                                     int64_t total, int64_t overlap, std::vector<Byte> &result) {
+  int inputFrameSize = input.channelLayout.nb_channels * av_get_bytes_per_sample(input.fmt);
+  int outputFrameSize = output.channelLayout.nb_channels * av_get_bytes_per_sample(output.fmt);
+  int64_t g = std::gcd(input.sampleRate, output.sampleRate);
+  int64_t inputStep = input.sampleRate / g;
+  int64_t outputStep = output.sampleRate / g;
+
+  // the lead-in is resampled and thrown away, the lead-out only feeds the filter
+  auto from = std::max<int64_t>(0, begin - overlap);
+  auto to = std::min(total, end + overlap);
+  bool last = end == total;
+  // a lead-out cut short by the end of the file may not cover the filter delay, flush it out
+  bool flush = to == total;
+  auto skip = (begin - from) / inputStep * outputStep;
+  auto wanted = last ? INT64_MAX : (end - begin) / inputStep * outputStep;
+
+  std::vector<Byte> in((size_t)(to - from) * inputFrameSize);
+  std::vector<Byte> out;
+  int converted = 0;
+  bool success = false;
+  int ret;
+  SwrContext *ctx = nullptr;
+  Byte *data = nullptr;
+  const Byte *inputData = in.data();
+
+  FileReader inputFile;
+  if (!inputFile.open(input.filename) ||
+      inputFile.readAt(from * inputFrameSize, in.data(), in.size()) != (int64_t)in.size()) {
+    av_log(nullptr, AV_LOG_ERROR, "Failed to read %s\n", input.filename.c_str());
+    return false;
+  }
+
+  ret = swr_alloc_set_opts2(&ctx, &output.channelLayout, output.fmt, output.sampleRate,
+                            &input.channelLayout, input.fmt, input.sampleRate, 0, nullptr);
+  if (ret < 0 || (ret = swr_init(ctx)) < 0) {
+    log_error(ret);
+    goto end;
+  }
+
+  out.resize((size_t)swr_get_out_samples(ctx, (int)(to - from)) * outputFrameSize);
+  data = out.data();
+  ret = swr_convert(ctx, &data, (int)(out.size() / outputFrameSize), &inputData, (int)(to - from));
+  if (ret < 0) {
+    log_error(ret);
+    goto end;
+  }
+  converted = ret;
+  if (flush) {
+    // the tail the serial path gets out of its final flush
+    out.resize((size_t)(converted + swr_get_out_samples(ctx, 0)) * outputFrameSize);
+    while (true) {
+      data = out.data() + (size_t)converted * outputFrameSize;
+      ret = swr_convert(ctx, &data, (int)(out.size() / outputFrameSize) - converted, nullptr, 0);
+      if (ret <= 0) {
+        break;
+      }
+      converted += ret;
+    }
+  }
+
+  result.clear();
+  if (converted > skip) {
+    auto frames = std::min<int64_t>(converted - skip, wanted);
+    auto first = out.begin() + skip * outputFrameSize;
+    result.assign(first, first + frames * outputFrameSize);
+  }
+  // short of a whole chunk the seam would lose samples against the serial path
+  success = last || (int64_t)result.size() == wanted * outputFrameSize;
+  if (!success) {
+    av_log(nullptr, AV_LOG_ERROR, "Resampled chunk at %.2fs came out short\n",
+           (double)begin / input.sampleRate);
+  }
+
+end:
+  swr_free(&ctx);
+  return success;
+}
+
 void Player::Recorder::resample() const {
   ResampleAudioSpec input;
   ResampleAudioSpec output;
@@ -281,7 +660,9 @@ void Player::Recorder::resample() const {
   output.sampleRate = 44100;
   output.channelLayout = AV_CHANNEL_LAYOUT_STEREO;
 
-  resample(input, output);
+  if (!resampleParallel(input, output)) {
+    return;
+  }
 
   Spec spec;
   spec.channels = output.channelLayout.nb_channels;
@@ -295,23 +676,29 @@ void Player::Recorder::resample() const {
   Player::Recorder::pcm2Wav(header, output.filename, p.string());
 }
 
-bool Player::Recorder::checkSampleFmt(const AVCodec *codec, AVSampleFormat fmt) {
-  auto p = codec->sample_fmts;
-  while (*p != AV_SAMPLE_FMT_NONE) {
-    if (*p == fmt) {
-      return true;
-    }
-    p++;
-  }
-  return false;
+void Player::Recorder::pipeline(bool keep) const {
+  ResampleAudioSpec input;
+  ResampleAudioSpec resampled;
+  ResampleAudioSpec decoded;
+
+  input.filename = "../resources/out.pcm";
+  input.fmt = static_cast<AVSampleFormat>(fmt_);
+  input.sampleRate = 48000;
+  input.channelLayout = AV_CHANNEL_LAYOUT_MONO;
+
+  resampled.filename = "../resources/resample.pcm";
+  resampled.fmt = static_cast<AVSampleFormat>(AV_SAMPLE_FMT_S16);
+  resampled.sampleRate = 44100;
+  resampled.channelLayout = AV_CHANNEL_LAYOUT_STEREO;
+
+  decoded.filename = "../resources/resample1.pcm";
+  AudioPipeline::run(input, resampled, decoded, keep);
 }
 
-void Player::Recorder::pcm2AAC(Player::ResampleAudioSpec &spec, std::string aacFilename) {
-  std::ifstream input;
-  input.open(spec.filename, std::ios::binary);
-  if (!input.is_open()) {
-    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to open input file");
-    return;
+bool Player::Recorder::pcm2AAC(Player::ResampleAudioSpec &spec, std::string aacFilename) {
+  FileReader input;
+  if (!input.open(spec.filename)) {
+    return false;
   }
 
   if (aacFilename.empty()) {
@@ -319,100 +706,47 @@ void Player::Recorder::pcm2AAC(Player::ResampleAudioSpec &spec, std::string aacF
     aacFilename = p.replace_extension("aac").string();
   }
 
-  std::ofstream output;
-  output.open(aacFilename, std::ios::binary);
-  if (!output.is_open()) {
-    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to open output file");
-    return;
-  }
-
-  AVCodecContext *ctx = nullptr;
-  AVFrame *pcm = nullptr;
-  AVPacket *pkt = nullptr;
-  int ret;
-
-  auto encoderName = "libfdk_aac";
-  //  avcodec_find_encoder(AV_CODEC_ID_AAC);
-  const AVCodec *codec = avcodec_find_encoder_by_name(encoderName);
-  if (!codec) {
-    av_log(nullptr, AV_LOG_ERROR, "Can not find encoder by %s\n", encoderName);
-    return;
-  }
-
-  if (!checkSampleFmt(codec, spec.fmt)) {
-    // need resample
-    av_log(nullptr, AV_LOG_ERROR, "Unsupported sample format %s\n",
-           av_get_sample_fmt_name(spec.fmt));
-    return;
-  }
-
-  ctx = avcodec_alloc_context3(codec);
-  if (!ctx) {
-    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call avcodec_alloc_context3");
-    return;
-  }
-
-  ctx->sample_rate = spec.sampleRate;
-  ctx->sample_fmt = spec.fmt;
-  ctx->ch_layout = spec.channelLayout;
-  /*
-   ffmpeg -ar 44100 -ac 2 -f s16le -i ./resample.pcm -c:a libfdk_aac -profile:a aac_he_v2 -b:a 32k
-   output.aac
-   */
-  //  ctx->bit_rate = 32000;
-  //  ctx->profile = FF_PROFILE_AAC_HE_V2;
-  AVDictionary *opts = nullptr;
-  // ffmpeg -ar 44100 -ac 2 -f s16le -i ./resample.pcm -c:a libfdk_aac -vbr 5 output.aac
-  av_dict_set(&opts, "vbr", "1", 0);
-  ret = avcodec_open2(ctx, codec, &opts);
-  if (ret < 0) {
-    log_error(ret);
-    goto end;
-  }
-
-  pcm = av_frame_alloc();
-  if (!pcm) {
-    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call av_frame_alloc");
-    goto end;
-  }
-
-  pcm->nb_samples = ctx->frame_size;
-  pcm->format = ctx->sample_fmt;
-  pcm->ch_layout = ctx->ch_layout;
-
-  ret = av_frame_get_buffer(pcm, 0);
-  if (ret < 0) {
-    log_error(ret);
-    goto end;
-  }
-
-  pkt = av_packet_alloc();
-  if (!pkt) {
-    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call av_packet_alloc");
-    goto end;
-  }
-
-  while (
-      (ret = (int)input.read(reinterpret_cast<char *>(pcm->data[0]), pcm->linesize[0]).gcount()) >
-      0) {
-    if (ret < pcm->linesize[0]) {
-      int bytes = av_get_bytes_per_sample((AVSampleFormat)pcm->format);
-      int ch = pcm->ch_layout.nb_channels;
-      pcm->nb_samples = ret / (bytes * ch);
-    }
-    if (encode(ctx, pcm, pkt, output) < 0) {
-      goto end;
+  // AudioEncoder converts to whatever the encoder takes, so the native encoder's fltp works too;
+  // the output is ADTS whatever the file is called
+  FileAVIO output;
+  Muxer muxer;
+  AudioEncoder encoder;
+  auto params = avcodec_parameters_alloc();
+  auto pkt = av_packet_alloc();
+  auto pb = output.openWrite(aacFilename);
+  int frameSize = spec.channelLayout.nb_channels * av_get_bytes_per_sample(spec.fmt);
+  bool success = params && pkt && pb && frameSize > 0 &&
+                 av_new_packet(pkt, AAC_READ_SAMPLES * frameSize) == 0;
+  if (success) {
+    params->sample_rate = spec.sampleRate;
+    success = av_channel_layout_copy(&params->ch_layout, &spec.channelLayout) == 0 &&
+              muxer.open(pb, "adts") &&
+              encoder.open(muxer, params, spec.fmt, spec.sampleRate) && muxer.start();
+  }
+  if (success) {
+    pkt->pts = 0;
+    size_t len;
+    while ((len = input.read(pkt->data, pkt->size)) > 0) {
+      // only the last read comes back short
+      if ((int)len < pkt->size) {
+        av_shrink_packet(pkt, (int)len);
+      }
+      if (!encoder.encode(pkt)) {
+        success = false;
+        break;
+      }
     }
   }
-  encode(ctx, nullptr, pkt, output);
-
-end:
-  input.close();
+  encoder.close();
+  muxer.close();
+  // write errors only show up on the context
+  success = success && !pb->error;
   output.close();
+  input.close();
 
-  av_frame_free(&pcm);
   av_packet_free(&pkt);
-  avcodec_free_context(&ctx);
+  avcodec_parameters_free(&params);
+  return success;
 }
 
 void Player::Recorder::pcm2AAC() {
@@ -424,77 +758,175 @@ void Player::Recorder::pcm2AAC() {
   pcm2AAC(input);
 }
 
-int Player::Recorder::encode(AVCodecContext *ctx, AVFrame *frame, AVPacket *pkt,
-                             std::ofstream &output) {
-  int ret = avcodec_send_frame(ctx, frame);
-  if (ret < 0) {
-    log_error(ret);
-    return ret;
+// ffmpeg -hide_banner -f avfoundation -framerate 30 -pixel_format yuyv422 -i 0: out.yuv
+void Player::Recorder::recordVideo() {
+  if (recording_) {
+    stop();
+    return;
   }
-  while (true) {
-    ret = avcodec_receive_packet(ctx, pkt);
-    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-      return 0;
-    } else if (ret < 0) {
-      log_error(ret);
-      break;
-    }
-    output.write(reinterpret_cast<const char *>(pkt->data), pkt->size);
-    av_packet_unref(pkt);
+  bool raw = fs::path(filename()).extension().string() == ".yuv";
+  std::thread writeThread(raw ? &Player::Recorder::writeYUV : &Player::Recorder::writeVideo, this);
+  writeThread.detach();
+}
+
+void Player::Recorder::setVideoEncoder(const std::string &name) { videoEncoder_ = name; }
+
+// ffmpeg -hide_banner -f avfoundation -framerate 30 -i 0: -c:v libx264 out.mkv
+void Player::Recorder::writeVideo() {
+  if (filename().empty()) {
+    return;
+  }
+
+  AVDictionary *opts = nullptr;
+  av_dict_set(&opts, "video_size", "640x480", 0);
+  av_dict_set(&opts, "framerate", "30", 0);
+  recording_ = openDevice(AVMEDIA_TYPE_VIDEO, &opts);
+  av_dict_free(&opts);
+  if (!recording_) {
+    return;
   }
-  return ret;
+
+  auto stream = context()->streams[0];
+  auto frameRate = av_guess_frame_rate(context(), stream, nullptr);
+  Muxer muxer;
+  VideoEncoder encoder;
+  if (muxer.open(filename()) &&
+      encoder.open(muxer, stream->codecpar, AV_TIME_BASE_Q, frameRate, videoEncoder_) &&
+      muxer.start()) {
+    // the capture thread only queues frames, conversion and encoding run on the writer thread;
+    // packets keep their capture time, so dropped frames stay in sync
+    CaptureClock clock;
+    FrameDecimator decimator(frameRate);
+    capture(
+        context(), [&encoder](const AVPacket *pkt) { encoder.encode(pkt); }, 32, &decimator,
+        &clock);
+    av_log(nullptr, AV_LOG_INFO, "%lld frames encoded with %s\n", (long long)encoder.frames(),
+           encoder.name());
+    decimator.dump();
+    encoder.close();
+  }
+  muxer.close();
+
+  closeDevice();
+  stop();
 }
 
-// ffmpeg -hide_banner -f avfoundation -framerate 30 -pixel_format yuyv422 -i 0: out.yuv
-void Player::Recorder::recordVideo() {
+// ffmpeg -f avfoundation -framerate 30 -i 0:0 -c:v libx264 -c:a libfdk_aac out.mkv
+void Player::Recorder::recordAV() {
   if (recording_) {
     stop();
     return;
   }
-  std::thread writeThread(&Player::Recorder::writeYUV, this);
+  std::thread writeThread(&Player::Recorder::writeAV, this);
   writeThread.detach();
 }
 
-void Player::Recorder::writeYUV() {
+void Player::Recorder::writeAV() {
   if (filename().empty()) {
     return;
   }
 
-  std::ofstream file;
-  file.open(filename(), std::ios::binary);
-  if (!file.is_open()) {
+  // a second recorder holds the microphone, ctx_ the camera
+  Recorder audio;
+  audio.audioDevice_ = audioDevice_;
+  AVDictionary *opts = nullptr;
+  av_dict_set(&opts, "video_size", "640x480", 0);
+  av_dict_set(&opts, "framerate", "30", 0);
+  recording_ = openDevice(AVMEDIA_TYPE_VIDEO, &opts) && audio.openDevice(AVMEDIA_TYPE_AUDIO);
+  av_dict_free(&opts);
+  if (!recording_) {
+    audio.closeDevice();
+    closeDevice();
     return;
   }
+
+  auto stream = context()->streams[0];
+  auto frameRate = av_guess_frame_rate(context(), stream, nullptr);
+  Muxer muxer;
+  VideoEncoder video;
+  AudioEncoder sound;
+  if (muxer.open(filename()) &&
+      video.open(muxer, stream->codecpar, AV_TIME_BASE_Q, frameRate, videoEncoder_) &&
+      sound.open(muxer, audio.context()->streams[0]->codecpar,
+                 static_cast<AVSampleFormat>(audio.fmt_)) &&
+      muxer.start()) {
+    // both devices are read on threads of their own and stamped against one clock, each has its
+    // own encoder thread, the muxer interleaves on a fifth
+    CaptureClock clock;
+    FrameDecimator decimator(frameRate);
+    std::thread microphone([&] {
+      capture(
+          audio.context(),
+          [this, &sound](const AVPacket *pkt) {
+            if (!sound.encode(pkt)) {
+              stop();
+            }
+          },
+          256, nullptr, &clock);
+    });
+    // the video side failing ends the whole recording, muxing on would leave an audio-only tail
+    std::atomic<bool> failed{false};
+    bool captured = capture(
+        context(),
+        [this, &video, &failed](const AVPacket *pkt) {
+          if (!video.encode(pkt)) {
+            failed = true;
+            stop();
+          }
+        },
+        32, &decimator, &clock);
+    if (!captured || failed) {
+      muxer.abort();
+    }
+    stop();
+    microphone.join();
+    av_log(nullptr, AV_LOG_INFO, "%lld frames encoded with %s, audio with %s\n",
+           (long long)video.frames(), video.name(), sound.name());
+    decimator.dump();
+    video.close();
+    sound.close();
+  }
+  muxer.close();
+
+  audio.closeDevice();
+  closeDevice();
+  stop();
+}
+
+void Player::Recorder::writeYUV() {
+  if (filename().empty()) {
+    return;
+  }
+
   AVDictionary *opts = nullptr;
   av_dict_set(&opts, "video_size", "640x480", 0);
-  av_dict_set(&opts, "pixel_format", "yuyv422", 0);
   av_dict_set(&opts, "framerate", "30", 0);
 
-  recording_ = openDevice(VIDEO_DEVICE_NAME, &opts);
-  auto params = context()->streams[0]->codecpar;
-  int imageSize =
-      av_image_get_buffer_size((AVPixelFormat)params->format, params->width, params->height, 1);
-  int ret;
-  auto pkt = av_packet_alloc();
-  if (!pkt) {
-    goto end;
+  recording_ = openDevice(AVMEDIA_TYPE_VIDEO, &opts);
+  av_dict_free(&opts);
+  if (!recording_) {
+    return;
   }
-  while (recording_) {
-    ret = av_read_frame(context(), pkt);
-    if (ret == 0) {
-      file.write(reinterpret_cast<const char *>(pkt->data), imageSize);
-      av_packet_unref(pkt);
-    } else if (ret == AVERROR(EAGAIN)) {
-      continue;
-    } else {
-      log_error(ret);
-      goto end;
-    }
+  FileWriter file;
+  if (!file.open(filename(), preallocation(context()))) {
+    closeDevice();
+    stop();
+    return;
   }
+  auto stream = context()->streams[0];
+  auto params = stream->codecpar;
+  // whatever negotiate() settled on, so RawVideo can play the file back
+  RawVideo::describe(filename(), params->width, params->height,
+                     av_guess_frame_rate(context(), stream, nullptr),
+                     (AVPixelFormat)params->format);
+  int imageSize =
+      av_image_get_buffer_size((AVPixelFormat)params->format, params->width, params->height, 1);
+  // about a second of raw frames; no decimator, a .yuv file has no timestamps and played at the
+  // nominal rate every dropped frame would pull the rest forward
+  capture(
+      context(), [&file, imageSize](const AVPacket *pkt) { file.write(pkt->data, imageSize); },
+      32);
 
-end:
-  av_packet_free(&pkt);
-  file.flush();
   file.close();
   closeDevice();
   stop();
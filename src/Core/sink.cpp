@@ -0,0 +1,123 @@
+#include "Core/sink.h"
+
+#include <chrono>
+
+// 快速模式下所有源都跟不上时，再次回调前等待的时间(毫秒)
+#define NULL_SINK_WAIT_MS 1
+
+Player::DeviceSink::~DeviceSink() { close(); }
+
+bool Player::DeviceSink::open(const SDL_AudioSpec &desired, SDL_AudioSpec &obtained) {
+  // keep the sample format, SDL converts if the hardware disagrees
+  device_ = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained,
+                                SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE |
+                                    SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+  if (!device_) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    return false;
+  }
+  return true;
+}
+
+void Player::DeviceSink::close() {
+  if (device_) {
+    SDL_CloseAudioDevice(device_);
+    device_ = 0;
+  }
+}
+
+void Player::DeviceSink::pause(bool paused) { SDL_PauseAudioDevice(device_, paused); }
+
+void Player::DeviceSink::lock() { SDL_LockAudioDevice(device_); }
+
+void Player::DeviceSink::unlock() { SDL_UnlockAudioDevice(device_); }
+
+Player::NullSink::~NullSink() { close(); }
+
+bool Player::NullSink::open(const SDL_AudioSpec &desired, SDL_AudioSpec &obtained) {
+  if (running_ || !desired.callback || desired.freq < 1 || desired.samples < 1) {
+    return false;
+  }
+  obtained = desired;
+  obtained.silence = obtained.format == AUDIO_U8 ? 0x80 : 0;
+  obtained.size = obtained.samples * (SDL_AUDIO_BITSIZE(obtained.format) >> 3) * obtained.channels;
+  spec_ = obtained;
+  buffer_.resize(spec_.size);
+  played_ = 0;
+  paused_ = true;
+  running_ = true;
+  thread_ = std::thread(&Player::NullSink::run, this);
+  return true;
+}
+
+void Player::NullSink::close() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(pauseMutex_);
+    running_ = false;
+    pauseCond_.notify_all();
+  }
+  thread_.join();
+}
+
+void Player::NullSink::pause(bool paused) {
+  std::lock_guard<std::mutex> lock(pauseMutex_);
+  paused_ = paused;
+  pauseCond_.notify_all();
+}
+
+void Player::NullSink::lock() { mutex_.lock(); }
+
+void Player::NullSink::unlock() { mutex_.unlock(); }
+
+void Player::NullSink::run() {
+  using namespace std::chrono;
+  auto period = microseconds((int64_t)spec_.samples * 1000000 / spec_.freq);
+  auto next = steady_clock::now();
+  while (running_) {
+    {
+      std::unique_lock<std::mutex> lock(pauseMutex_);
+      if (paused_) {
+        pauseCond_.wait(lock, [this] { return !paused_ || !running_; });
+        next = steady_clock::now();
+        continue;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      filled_ = (int)buffer_.size();
+      spec_.callback(spec_.userdata, buffer_.data(), (int)buffer_.size());
+    }
+    played_ += filled_;
+    if (realtime_) {
+      // a device plays the silence too
+      write(buffer_.data(), (int)buffer_.size());
+      next += period;
+      std::this_thread::sleep_until(next);
+    } else if (filled_ > 0) {
+      write(buffer_.data(), filled_);
+    } else {
+      std::this_thread::sleep_for(milliseconds(NULL_SINK_WAIT_MS));
+    }
+  }
+}
+
+double Player::NullSink::played() const {
+  auto frameSize = (SDL_AUDIO_BITSIZE(spec_.format) >> 3) * spec_.channels;
+  return frameSize > 0 && spec_.freq > 0 ? (double)played_ / frameSize / spec_.freq : 0;
+}
+
+Player::FileSink::FileSink(const std::string &filename, bool realtime) : NullSink(realtime) {
+  output_.open(filename);
+}
+
+// the thread must be gone before output_ is
+Player::FileSink::~FileSink() { close(); }
+
+void Player::FileSink::write(const Byte *data, int len) {
+  if (output_.isOpen()) {
+    output_.write(data, len);
+  }
+}
@@ -0,0 +1,18 @@
+#include "Core/source.h"
+
+Player::RingSource::RingSource(const SDL_AudioSpec &spec, size_t capacity)
+    : AudioSource(spec), ring_(capacity) {}
+
+int Player::RingSource::pull(Byte *stream, int len) { return (int)ring_.read(stream, len); }
+
+bool Player::RingSource::finished() const { return eof_ && ring_.size() < 1; }
+
+int Player::RingSource::fill() const { return (int)(ring_.size() * 100 / ring_.capacity()); }
+
+bool Player::MappedSource::open(const std::string &filename, size_t offset) {
+  return file_.open(filename, offset);
+}
+
+int Player::MappedSource::pull(Byte *stream, int len) { return (int)file_.read(stream, len); }
+
+bool Player::MappedSource::finished() const { return file_.remaining() < 1; }
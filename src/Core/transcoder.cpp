@@ -0,0 +1,173 @@
+#include "Core/transcoder.h"
+#include "Core/audio.h"
+#include "Core/recorder.h"
+#include "Utils/thread_pool.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static uintmax_t fileSize(const std::string &filename) {
+  std::error_code ec;
+  auto size = fs::file_size(filename, ec);
+  return ec ? 0 : size;
+}
+
+// the output is truncated before the job reads its input, so it must not name the same file
+static bool sameFile(const std::string &input, const std::string &output) {
+  std::error_code ec;
+  if (fs::equivalent(input, output, ec)) {
+    return true;
+  }
+  // either may only be written by an earlier job
+  auto a = fs::weakly_canonical(input, ec);
+  if (ec) {
+    return false;
+  }
+  auto b = fs::weakly_canonical(output, ec);
+  return !ec && a == b;
+}
+
+static const char *kindName(Player::TranscodeJob::Kind kind) {
+  switch (kind) {
+  case Player::TranscodeJob::Encode:
+    return "encode";
+  case Player::TranscodeJob::Decode:
+    return "decode";
+  default:
+    return "resample";
+  }
+}
+
+void Player::Transcoder::add(const TranscodeJob &job) { jobs_.push_back(job); }
+
+bool Player::Transcoder::parse(std::istream &line, ResampleAudioSpec &spec, bool pcm) {
+  if (!(line >> spec.filename)) {
+    return false;
+  }
+  if (!pcm) {
+    return true;
+  }
+  std::string fmt;
+  int channels = 0;
+  if (!(line >> spec.sampleRate >> fmt >> channels) || channels < 1) {
+    return false;
+  }
+  spec.fmt = av_get_sample_fmt(fmt.c_str());
+  av_channel_layout_default(&spec.channelLayout, channels);
+  return spec.fmt != AV_SAMPLE_FMT_NONE;
+}
+
+bool Player::Transcoder::load(const std::string &manifest) {
+  std::ifstream input(manifest);
+  if (!input.is_open()) {
+    av_log(nullptr, AV_LOG_ERROR, "Failed to open %s\n", manifest.c_str());
+    return false;
+  }
+  std::string text;
+  int number = 0;
+  while (std::getline(input, text)) {
+    number++;
+    std::istringstream line(text.substr(0, text.find('#')));
+    std::string kind;
+    if (!(line >> kind)) {
+      continue;
+    }
+    TranscodeJob job;
+    bool ok;
+    if (kind == "encode") {
+      job.kind = TranscodeJob::Encode;
+      ok = parse(line, job.input, true) && parse(line, job.output, false);
+    } else if (kind == "decode") {
+      job.kind = TranscodeJob::Decode;
+      ok = parse(line, job.input, false) && parse(line, job.output, false);
+    } else if (kind == "resample") {
+      job.kind = TranscodeJob::Resample;
+      ok = parse(line, job.input, true) && parse(line, job.output, true);
+    } else {
+      ok = false;
+    }
+    if (ok && sameFile(job.input.filename, job.output.filename)) {
+      av_log(nullptr, AV_LOG_ERROR, "%s:%d: output would overwrite the input\n", manifest.c_str(),
+             number);
+      return false;
+    }
+    if (!ok) {
+      av_log(nullptr, AV_LOG_ERROR, "%s:%d: bad job \"%s\"\n", manifest.c_str(), number,
+             text.c_str());
+      return false;
+    }
+    add(job);
+  }
+  return true;
+}
+
+Player::TranscodeResult Player::Transcoder::execute(TranscodeJob &job) {
+  TranscodeResult result;
+  auto begin = av_gettime_relative();
+  // a failed job must not leave an older output behind
+  std::error_code ec;
+  fs::remove(job.output.filename, ec);
+  switch (job.kind) {
+  case TranscodeJob::Encode:
+    result.success = Recorder::pcm2AAC(job.input, job.output.filename);
+    break;
+  case TranscodeJob::Decode:
+    result.success = Audio::decodeAAC(job.input.filename, job.output);
+    break;
+  case TranscodeJob::Resample:
+    result.success = Recorder::resampleParallel(job.input, job.output);
+    break;
+  }
+  result.seconds = (double)(av_gettime_relative() - begin) / AV_TIME_BASE;
+  result.inputBytes = fileSize(job.input.filename);
+  result.outputBytes = fileSize(job.output.filename);
+  return result;
+}
+
+bool Player::Transcoder::run() {
+  results_.assign(jobs_.size(), {});
+  auto begin = av_gettime_relative();
+  {
+    // submit() blocks once the queue is full, the manifest is never expanded all at once
+    ThreadPool pool(threads_);
+    for (size_t i = 0; i < jobs_.size(); ++i) {
+      pool.submit([this, i] {
+        results_[i] = execute(jobs_[i]);
+        auto &job = jobs_[i];
+        auto &result = results_[i];
+        av_log(nullptr, result.success ? AV_LOG_INFO : AV_LOG_ERROR,
+               "%-8s %s %6.2fs %s -> %s\n", kindName(job.kind), result.success ? "ok  " : "FAIL",
+               result.seconds, job.input.filename.c_str(), job.output.filename.c_str());
+      });
+    }
+  }
+  report((double)(av_gettime_relative() - begin) / AV_TIME_BASE);
+  return std::all_of(results_.begin(), results_.end(),
+                     [](const TranscodeResult &result) { return result.success; });
+}
+
+void Player::Transcoder::report(double seconds) const {
+  size_t failed = 0;
+  double busy = 0;
+  uintmax_t inputBytes = 0;
+  uintmax_t outputBytes = 0;
+  for (auto &result : results_) {
+    failed += !result.success;
+    busy += result.seconds;
+    inputBytes += result.inputBytes;
+    outputBytes += result.outputBytes;
+  }
+  auto mb = [](uintmax_t bytes) { return (double)bytes / (1 << 20); };
+  av_log(nullptr, AV_LOG_INFO, "%zu jobs, %zu failed in %.2fs\n", results_.size(), failed,
+         seconds);
+  if (seconds > 0) {
+    // busy / wall is how many workers were kept busy on average
+    av_log(nullptr, AV_LOG_INFO,
+           "read %.1f MB (%.1f MB/s), wrote %.1f MB, %.1f jobs/s, %.2fx parallel\n",
+           mb(inputBytes), mb(inputBytes) / seconds, mb(outputBytes),
+           (double)results_.size() / seconds, busy / seconds);
+  }
+}
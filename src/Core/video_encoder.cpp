@@ -0,0 +1,191 @@
+#include "Core/video_encoder.h"
+#include "Core/muxer.h"
+#include "Utils/color_kernels.h"
+
+// 毫秒时间基，mpeg4 要求分母不超过 65535
+static const AVRational encoderTimeBase = {1, 1000};
+
+// tried in order when no encoder is named
+static const char *encoders[] = {"libx264", "mpeg4", "ffv1"};
+
+Player::VideoEncoder::~VideoEncoder() { close(); }
+
+bool Player::VideoEncoder::open(Muxer &muxer, const AVCodecParameters *input,
+                                AVRational timeBase, AVRational frameRate,
+                                const std::string &encoder) {
+  close();
+  muxer_ = &muxer;
+  width_ = input->width;
+  height_ = input->height;
+  format_ = (AVPixelFormat)input->format;
+  timeBase_ = timeBase;
+  lastPts_ = AV_NOPTS_VALUE;
+  count_ = 0;
+
+  const AVCodec *codec = nullptr;
+  if (encoder.empty()) {
+    for (auto name : encoders) {
+      codec = avcodec_find_encoder_by_name(name);
+      if (codec && openEncoder(codec, frameRate, muxer.globalHeader())) {
+        break;
+      }
+      codec = nullptr;
+    }
+  } else if ((codec = avcodec_find_encoder_by_name(encoder.c_str())) &&
+             !openEncoder(codec, frameRate, muxer.globalHeader())) {
+    codec = nullptr;
+  }
+  if (!codec) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "No usable video encoder");
+    close();
+    return false;
+  }
+
+  raw_ = av_frame_alloc();
+  if (!raw_) {
+    close();
+    return false;
+  }
+  convert_ = ctx_->pix_fmt != format_;
+  if (convert_ && !frames_.init(ctx_->pix_fmt, width_, height_)) {
+    close();
+    return false;
+  }
+  if ((stream_ = muxer.addStream(ctx_)) < 0) {
+    close();
+    return false;
+  }
+  av_log(nullptr, AV_LOG_INFO, "%s %dx%d %s -> %s\n", name(), width_, height_,
+         av_get_pix_fmt_name(format_), av_get_pix_fmt_name(ctx_->pix_fmt));
+  return true;
+}
+
+bool Player::VideoEncoder::openEncoder(const AVCodec *codec, AVRational frameRate,
+                                       bool globalHeader) {
+  ctx_ = avcodec_alloc_context3(codec);
+  if (!ctx_) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call avcodec_alloc_context3");
+    return false;
+  }
+  ctx_->width = width_;
+  ctx_->height = height_;
+  // the format cheapest to convert the device's into
+  ctx_->pix_fmt = codec->pix_fmts
+                      ? avcodec_find_best_pix_fmt_of_list(codec->pix_fmts, format_, 0, nullptr)
+                      : format_;
+  ctx_->time_base = encoderTimeBase;
+  ctx_->framerate = frameRate;
+  ctx_->gop_size = frameRate.num > 0 && frameRate.den > 0 ? 2 * frameRate.num / frameRate.den : 60;
+  // 0 lets the encoder use every core
+  ctx_->thread_count = 0;
+  ctx_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+  switch (codec->id) {
+  case AV_CODEC_ID_H264:
+    av_opt_set(ctx_->priv_data, "preset", "veryfast", 0);
+    break;
+  case AV_CODEC_ID_MPEG4:
+    ctx_->bit_rate = 4000000;
+    break;
+  case AV_CODEC_ID_FFV1:
+    // version 3 codes slices in parallel
+    ctx_->level = 3;
+    break;
+  default:
+    break;
+  }
+  if (globalHeader) {
+    ctx_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+  int ret = avcodec_open2(ctx_, codec, nullptr);
+  if (ret < 0) {
+    log_error(ret);
+    avcodec_free_context(&ctx_);
+    return false;
+  }
+  return true;
+}
+
+bool Player::VideoEncoder::encode(const AVPacket *pkt) {
+  if (!ctx_ || stream_ < 0 || pkt->size < av_image_get_buffer_size(format_, width_, height_, 1)) {
+    return false;
+  }
+  // nothing is copied here, the encoder copies what it keeps
+  av_image_fill_arrays(raw_->data, raw_->linesize, pkt->data, format_, width_, height_, 1);
+  raw_->format = format_;
+  raw_->width = width_;
+  raw_->height = height_;
+
+  AVFrame *frame = raw_;
+  if (convert_) {
+    // a threaded encoder may still hold the previous frame, so each one gets its own buffer
+    if (!(frame = frames_.acquire())) {
+      return false;
+    }
+    // captured yuyv422 has its own kernels, swscale does the rest
+    if (!convertFrame(raw_, frame)) {
+      sws_ = sws_getCachedContext(sws_, width_, height_, format_, width_, height_, ctx_->pix_fmt,
+                                  SWS_BILINEAR, nullptr, nullptr, nullptr);
+      if (!sws_) {
+        frames_.release(frame);
+        return false;
+      }
+      sws_scale(sws_, raw_->data, raw_->linesize, 0, height_, frame->data, frame->linesize);
+    }
+  }
+
+  // capture timestamps, so dropped frames leave a gap instead of shifting everything after them
+  int64_t pts = lastPts_ == AV_NOPTS_VALUE ? 0 : lastPts_ + 1;
+  if (pkt->pts != AV_NOPTS_VALUE) {
+    pts = std::max(pts, av_rescale_q(pkt->pts, timeBase_, encoderTimeBase));
+  }
+  frame->pts = pts;
+  lastPts_ = pts;
+  count_++;
+  bool ok = send(frame);
+  if (convert_) {
+    frames_.release(frame);
+  }
+  return ok;
+}
+
+bool Player::VideoEncoder::send(AVFrame *frame) {
+  int ret = avcodec_send_frame(ctx_, frame);
+  if (ret < 0) {
+    log_error(ret);
+    return false;
+  }
+  while (true) {
+    auto pkt = av_packet_alloc();
+    if (!pkt) {
+      return false;
+    }
+    if ((ret = avcodec_receive_packet(ctx_, pkt)) < 0) {
+      av_packet_free(&pkt);
+      break;
+    }
+    // the muxer rescales into the stream's time base
+    pkt->stream_index = stream_;
+    if (!muxer_->write(pkt)) {
+      return false;
+    }
+  }
+  return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
+}
+
+void Player::VideoEncoder::close() {
+  if (ctx_ && stream_ >= 0) {
+    send(nullptr);
+  }
+  stream_ = -1;
+  avcodec_free_context(&ctx_);
+  sws_freeContext(sws_);
+  sws_ = nullptr;
+  av_frame_free(&raw_);
+  if (frames_.stats().requests) {
+    frames_.stats().dump("encoder frames");
+  }
+  frames_.close();
+  frames_.resetStats();
+}
+
+const char *Player::VideoEncoder::name() const { return ctx_ ? ctx_->codec->name : ""; }
@@ -16,6 +16,23 @@ SDL_Renderer *Player::Window::init() {
   return renderer;
 }
 
+SDL_Rect Player::Window::fit(int width, int height) {
+  SDL_Rect rect = {0, 0, WIDTH, HEIGHT};
+  if (width < 1 || height < 1) {
+    return rect;
+  }
+  if (width * HEIGHT < height * WIDTH) {
+    auto w = (width * HEIGHT * 1.0) / height;
+    rect.x = static_cast<int>((WIDTH - w) / 2);
+    rect.w = static_cast<int>(w);
+  } else {
+    auto h = (height * WIDTH * 1.0) / width;
+    rect.y = static_cast<int>((HEIGHT - h) / 2);
+    rect.h = static_cast<int>(h);
+  }
+  return rect;
+}
+
 Player::Window::~Window() { deinit(); }
 
 void Player::Window::deinit() {
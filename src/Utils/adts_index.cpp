@@ -0,0 +1,153 @@
+#include "Utils/adts_index.h"
+#include "Utils/file_io.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+
+#define ADTS_HEADER_SIZE 7
+#define ADTS_INDEX_MAGIC "ADTSIDX1"
+
+namespace fs = std::filesystem;
+
+static const int sampleRates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000,
+                                  22050, 16000, 12000, 11025, 8000,  7350};
+
+std::string Player::AdtsIndex::sidecar(const std::string &filename) { return filename + ".idx"; }
+
+int64_t Player::AdtsIndex::modified(const std::string &filename) {
+  std::error_code ec;
+  auto time = fs::last_write_time(filename, ec);
+  return ec ? 0 : (int64_t)time.time_since_epoch().count();
+}
+
+bool Player::AdtsIndex::open(const std::string &filename) {
+  if (load(filename)) {
+    return true;
+  }
+  if (!build(filename)) {
+    return false;
+  }
+  // a read-only directory only costs the next open another scan
+  save(filename);
+  return true;
+}
+
+bool Player::AdtsIndex::build(const std::string &filename) {
+  // frames are a few hundred bytes apart, the skips stay inside the read-ahead
+  FileReader input;
+  if (!input.open(filename)) {
+    return false;
+  }
+  entries_.clear();
+  samples_ = 0;
+  sampleRate_ = 0;
+
+  Byte header[ADTS_HEADER_SIZE];
+  uint64_t offset = 0;
+  int64_t frames = 0;
+  while (input.read(header, ADTS_HEADER_SIZE) == ADTS_HEADER_SIZE) {
+    // syncword 0xFFF
+    if (header[0] != 0xFF || (header[1] & 0xF0) != 0xF0) {
+      av_log(nullptr, AV_LOG_WARNING, "Lost ADTS sync at %llu in %s\n",
+             (unsigned long long)offset, filename.c_str());
+      break;
+    }
+    auto length = ((header[3] & 0x03) << 11) | (header[4] << 3) | (header[5] >> 5);
+    auto rate = (header[2] >> 2) & 0x0F;
+    if (length < ADTS_HEADER_SIZE || rate >= (int)std::size(sampleRates)) {
+      break;
+    }
+    sampleRate_ = sampleRates[rate];
+    if (frames++ % interval_ == 0) {
+      entries_.push_back({offset, samples_});
+    }
+    // 1024 samples per raw data block
+    samples_ += 1024 * ((header[6] & 0x03) + 1);
+    offset += length;
+    input.seek(input.tell() + length - ADTS_HEADER_SIZE);
+  }
+  fileSize_ = (uint64_t)input.size();
+  mtime_ = modified(filename);
+  return !entries_.empty() && sampleRate_ > 0;
+}
+
+bool Player::AdtsIndex::load(const std::string &filename) {
+  std::ifstream input(sidecar(filename), std::ios::binary);
+  if (!input.is_open()) {
+    return false;
+  }
+  char magic[sizeof(ADTS_INDEX_MAGIC) - 1];
+  uint64_t fileSize = 0;
+  int64_t mtime = 0;
+  int32_t interval = 0;
+  int32_t sampleRate = 0;
+  int64_t samples = 0;
+  uint64_t count = 0;
+  input.read(magic, sizeof(magic));
+  input.read(reinterpret_cast<char *>(&fileSize), sizeof(fileSize));
+  input.read(reinterpret_cast<char *>(&mtime), sizeof(mtime));
+  input.read(reinterpret_cast<char *>(&interval), sizeof(interval));
+  input.read(reinterpret_cast<char *>(&sampleRate), sizeof(sampleRate));
+  input.read(reinterpret_cast<char *>(&samples), sizeof(samples));
+  input.read(reinterpret_cast<char *>(&count), sizeof(count));
+  std::error_code ec;
+  if (!input || memcmp(magic, ADTS_INDEX_MAGIC, sizeof(magic)) != 0 ||
+      fileSize != fs::file_size(filename, ec) || mtime != modified(filename) ||
+      interval != interval_ || count < 1) {
+    return false;
+  }
+  std::vector<Entry> entries(count);
+  input.read(reinterpret_cast<char *>(entries.data()), (std::streamsize)(count * sizeof(Entry)));
+  if (!input) {
+    return false;
+  }
+  entries_.swap(entries);
+  fileSize_ = fileSize;
+  mtime_ = mtime;
+  sampleRate_ = sampleRate;
+  samples_ = samples;
+  return true;
+}
+
+bool Player::AdtsIndex::save(const std::string &filename) const {
+  std::ofstream output(sidecar(filename), std::ios::binary);
+  if (!output.is_open()) {
+    return false;
+  }
+  int32_t interval = interval_;
+  int32_t sampleRate = sampleRate_;
+  uint64_t count = entries_.size();
+  output.write(ADTS_INDEX_MAGIC, sizeof(ADTS_INDEX_MAGIC) - 1);
+  output.write(reinterpret_cast<const char *>(&fileSize_), sizeof(fileSize_));
+  output.write(reinterpret_cast<const char *>(&mtime_), sizeof(mtime_));
+  output.write(reinterpret_cast<const char *>(&interval), sizeof(interval));
+  output.write(reinterpret_cast<const char *>(&sampleRate), sizeof(sampleRate));
+  output.write(reinterpret_cast<const char *>(&samples_), sizeof(samples_));
+  output.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  output.write(reinterpret_cast<const char *>(entries_.data()),
+               (std::streamsize)(count * sizeof(Entry)));
+  return output.good();
+}
+
+size_t Player::AdtsIndex::lookup(int64_t ms, int64_t &skip, int outputRate) const {
+  skip = 0;
+  if (entries_.empty()) {
+    return 0;
+  }
+  // the index counts at the header rate, HE-AAC decodes at twice that
+  auto rate = outputRate > 0 ? outputRate : sampleRate_;
+  auto target = std::clamp<int64_t>(ms * rate / 1000, 0, samples_ * rate / sampleRate_);
+  auto sample = target * sampleRate_ / rate;
+  auto it =
+      std::upper_bound(entries_.begin(), entries_.end(), sample,
+                       [](int64_t value, const Entry &entry) { return value < entry.sample; });
+  auto &entry = it == entries_.begin() ? *it : *(it - 1);
+  skip = target - entry.sample * rate / sampleRate_;
+  return entry.offset;
+}
+
+int64_t Player::AdtsIndex::duration() const {
+  return sampleRate_ > 0 ? samples_ * 1000 / sampleRate_ : 0;
+}
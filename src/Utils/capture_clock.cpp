@@ -0,0 +1,15 @@
+#include "Utils/capture_clock.h"
+
+void Player::CaptureClock::stamp(Anchor &anchor, AVPacket *pkt, AVRational timeBase) const {
+  auto now = av_gettime_relative() - start_;
+  if (pkt->pts == AV_NOPTS_VALUE) {
+    // no device clock, the read time has to do
+    pkt->pts = pkt->dts = now;
+    return;
+  }
+  auto device = av_rescale_q(pkt->pts, timeBase, AV_TIME_BASE_Q);
+  if (anchor.offset == AV_NOPTS_VALUE) {
+    anchor.offset = now - device;
+  }
+  pkt->pts = pkt->dts = device + anchor.offset;
+}
@@ -0,0 +1,369 @@
+#include "Utils/color_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PLAYER_COLOR_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PLAYER_COLOR_NEON 1
+#include <arm_neon.h>
+#endif
+
+// BT.601 limited range in Q6, small enough for 16 bit lanes
+#define COLOR_Y 74
+#define COLOR_RV 102
+#define COLOR_GU 25
+#define COLOR_GV 52
+#define COLOR_BU 129
+
+// one row pair of yuyv422 from column `x` on; `y1` is null for the last row of an odd height,
+// `s1` is `s0` then. For NV12 `v` is `u + 1` and chroma samples are two bytes apart
+using YuyvPair = void (*)(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                          uint8_t *u, uint8_t *v, int x, int width);
+
+// one BGRA row from column `x` on
+using BgraRow = void (*)(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                         int x, int width);
+
+static inline uint8_t average(uint8_t a, uint8_t b) { return (uint8_t)((a + b + 1) >> 1); }
+
+static inline uint8_t clampByte(int value) { return (uint8_t)std::clamp(value, 0, 255); }
+
+template <bool NV12>
+static void yuyvPairScalar(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                           uint8_t *u, uint8_t *v, int x, int width) {
+  for (; x < width; x += 2) {
+    auto k = x / 2;
+    y0[x] = s0[2 * x];
+    if (y1) {
+      y1[x] = s1[2 * x];
+    }
+    if (x + 1 < width) {
+      y0[x + 1] = s0[2 * x + 2];
+      if (y1) {
+        y1[x + 1] = s1[2 * x + 2];
+      }
+    }
+    u[NV12 ? 2 * k : k] = average(s0[4 * k + 1], s1[4 * k + 1]);
+    v[NV12 ? 2 * k : k] = average(s0[4 * k + 3], s1[4 * k + 3]);
+  }
+}
+
+static void bgraRowScalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                          int x, int width) {
+  for (; x < width; ++x) {
+    int luma = (y[x] - 16) * COLOR_Y;
+    int cb = u[x / 2] - 128;
+    int cr = v[x / 2] - 128;
+    auto out = dst + 4 * x;
+    out[0] = clampByte((luma + COLOR_BU * cb + 32) >> 6);
+    out[1] = clampByte((luma - COLOR_GU * cb - COLOR_GV * cr + 32) >> 6);
+    out[2] = clampByte((luma + COLOR_RV * cr + 32) >> 6);
+    out[3] = 255;
+  }
+}
+
+template <YuyvPair Pair>
+static void yuyvFrame(const uint8_t *src, int srcStride, uint8_t *y, int yStride, uint8_t *u,
+                      int uStride, uint8_t *v, int vStride, int width, int height) {
+  for (int row = 0; row < height; row += 2) {
+    auto s0 = src + (size_t)row * srcStride;
+    bool pair = row + 1 < height;
+    Pair(s0, pair ? s0 + srcStride : s0, y + (size_t)row * yStride,
+         pair ? y + (size_t)(row + 1) * yStride : nullptr, u + (size_t)(row / 2) * uStride,
+         v + (size_t)(row / 2) * vStride, 0, width);
+  }
+}
+
+template <BgraRow Row>
+static void i420Frame(const uint8_t *y, int yStride, const uint8_t *u, int uStride,
+                      const uint8_t *v, int vStride, uint8_t *dst, int dstStride, int width,
+                      int height) {
+  for (int row = 0; row < height; ++row) {
+    Row(y + (size_t)row * yStride, u + (size_t)(row / 2) * uStride,
+        v + (size_t)(row / 2) * vStride, dst + (size_t)row * dstStride, 0, width);
+  }
+}
+
+#ifdef PLAYER_COLOR_X86
+
+template <bool NV12>
+static void yuyvPairSSE2(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                         uint8_t *u, uint8_t *v, int x, int width) {
+  if (!y1) {
+    yuyvPairScalar<NV12>(s0, s1, y0, y1, u, v, x, width);
+    return;
+  }
+  auto mask = _mm_set1_epi16(0x00FF);
+  auto zero = _mm_setzero_si128();
+  for (; x + 16 <= width; x += 16) {
+    auto a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s0 + 2 * x));
+    auto b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s0 + 2 * x + 16));
+    auto a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s1 + 2 * x));
+    auto b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s1 + 2 * x + 16));
+    // luma sits in the even bytes
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(y0 + x),
+                     _mm_packus_epi16(_mm_and_si128(a0, mask), _mm_and_si128(b0, mask)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(y1 + x),
+                     _mm_packus_epi16(_mm_and_si128(a1, mask), _mm_and_si128(b1, mask)));
+    // u v u v ... of both rows, averaged
+    auto c0 = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(b0, 8));
+    auto c1 = _mm_packus_epi16(_mm_srli_epi16(a1, 8), _mm_srli_epi16(b1, 8));
+    auto c = _mm_avg_epu8(c0, c1);
+    if (NV12) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x), c);
+    } else {
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(u + x / 2),
+                       _mm_packus_epi16(_mm_and_si128(c, mask), zero));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(v + x / 2),
+                       _mm_packus_epi16(_mm_srli_epi16(c, 8), zero));
+    }
+  }
+  yuyvPairScalar<NV12>(s0, s1, y0, y1, u, v, x, width);
+}
+
+static void bgraRowSSE2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                        int x, int width) {
+  auto zero = _mm_setzero_si128();
+  auto alpha = _mm_set1_epi8(-1);
+  for (; x + 8 <= width; x += 8) {
+    int32_t cb, cr;
+    memcpy(&cb, u + x / 2, sizeof(cb));
+    memcpy(&cr, v + x / 2, sizeof(cr));
+    auto luma = _mm_sub_epi16(
+        _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(y + x)), zero),
+        _mm_set1_epi16(16));
+    luma = _mm_mullo_epi16(luma, _mm_set1_epi16(COLOR_Y));
+    // every chroma sample covers two pixels
+    auto u8 = _mm_cvtsi32_si128(cb);
+    auto v8 = _mm_cvtsi32_si128(cr);
+    auto u16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(u8, u8), zero),
+                             _mm_set1_epi16(128));
+    auto v16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(v8, v8), zero),
+                             _mm_set1_epi16(128));
+    auto round = _mm_set1_epi16(32);
+    auto b = _mm_adds_epi16(luma, _mm_mullo_epi16(u16, _mm_set1_epi16(COLOR_BU)));
+    auto g = _mm_subs_epi16(luma, _mm_mullo_epi16(u16, _mm_set1_epi16(COLOR_GU)));
+    g = _mm_subs_epi16(g, _mm_mullo_epi16(v16, _mm_set1_epi16(COLOR_GV)));
+    auto r = _mm_adds_epi16(luma, _mm_mullo_epi16(v16, _mm_set1_epi16(COLOR_RV)));
+    b = _mm_srai_epi16(_mm_adds_epi16(b, round), 6);
+    g = _mm_srai_epi16(_mm_adds_epi16(g, round), 6);
+    r = _mm_srai_epi16(_mm_adds_epi16(r, round), 6);
+    auto bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+    auto ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * x), _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * x + 16), _mm_unpackhi_epi16(bg, ra));
+  }
+  bgraRowScalar(y, u, v, dst, x, width);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PLAYER_COLOR_AVX2 1
+
+template <bool NV12>
+__attribute__((target("avx2"))) static void yuyvPairAVX2(const uint8_t *s0, const uint8_t *s1,
+                                                         uint8_t *y0, uint8_t *y1, uint8_t *u,
+                                                         uint8_t *v, int x, int width) {
+  if (!y1) {
+    yuyvPairScalar<NV12>(s0, s1, y0, y1, u, v, x, width);
+    return;
+  }
+  auto mask = _mm256_set1_epi16(0x00FF);
+  auto zero = _mm256_setzero_si256();
+  for (; x + 32 <= width; x += 32) {
+    auto a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s0 + 2 * x));
+    auto b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s0 + 2 * x + 32));
+    auto a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s1 + 2 * x));
+    auto b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s1 + 2 * x + 32));
+    // packus works per 128 bit lane, put the quarters back in order
+    auto l0 = _mm256_packus_epi16(_mm256_and_si256(a0, mask), _mm256_and_si256(b0, mask));
+    auto l1 = _mm256_packus_epi16(_mm256_and_si256(a1, mask), _mm256_and_si256(b1, mask));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(y0 + x), _mm256_permute4x64_epi64(l0, 0xD8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(y1 + x), _mm256_permute4x64_epi64(l1, 0xD8));
+    auto c0 = _mm256_packus_epi16(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(b0, 8));
+    auto c1 = _mm256_packus_epi16(_mm256_srli_epi16(a1, 8), _mm256_srli_epi16(b1, 8));
+    auto c = _mm256_permute4x64_epi64(_mm256_avg_epu8(c0, c1), 0xD8);
+    if (NV12) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(u + x), c);
+    } else {
+      auto cu = _mm256_packus_epi16(_mm256_and_si256(c, mask), zero);
+      auto cv = _mm256_packus_epi16(_mm256_srli_epi16(c, 8), zero);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x / 2),
+                       _mm256_castsi256_si128(_mm256_permute4x64_epi64(cu, 0xD8)));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(v + x / 2),
+                       _mm256_castsi256_si128(_mm256_permute4x64_epi64(cv, 0xD8)));
+    }
+  }
+  yuyvPairSSE2<NV12>(s0, s1, y0, y1, u, v, x, width);
+}
+
+__attribute__((target("avx2"))) static void bgraRowAVX2(const uint8_t *y, const uint8_t *u,
+                                                        const uint8_t *v, uint8_t *dst, int x,
+                                                        int width) {
+  auto alpha = _mm256_set1_epi8(-1);
+  for (; x + 16 <= width; x += 16) {
+    auto luma = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x)));
+    luma = _mm256_mullo_epi16(_mm256_sub_epi16(luma, _mm256_set1_epi16(16)),
+                              _mm256_set1_epi16(COLOR_Y));
+    auto u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2));
+    auto v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2));
+    auto u16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, u8)),
+                                _mm256_set1_epi16(128));
+    auto v16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v8, v8)),
+                                _mm256_set1_epi16(128));
+    auto round = _mm256_set1_epi16(32);
+    auto b = _mm256_adds_epi16(luma, _mm256_mullo_epi16(u16, _mm256_set1_epi16(COLOR_BU)));
+    auto g = _mm256_subs_epi16(luma, _mm256_mullo_epi16(u16, _mm256_set1_epi16(COLOR_GU)));
+    g = _mm256_subs_epi16(g, _mm256_mullo_epi16(v16, _mm256_set1_epi16(COLOR_GV)));
+    auto r = _mm256_adds_epi16(luma, _mm256_mullo_epi16(v16, _mm256_set1_epi16(COLOR_RV)));
+    b = _mm256_srai_epi16(_mm256_adds_epi16(b, round), 6);
+    g = _mm256_srai_epi16(_mm256_adds_epi16(g, round), 6);
+    r = _mm256_srai_epi16(_mm256_adds_epi16(r, round), 6);
+    // per lane: pixels 0-7 in the low one, 8-15 in the high one
+    auto bg = _mm256_unpacklo_epi8(_mm256_packus_epi16(b, b), _mm256_packus_epi16(g, g));
+    auto ra = _mm256_unpacklo_epi8(_mm256_packus_epi16(r, r), alpha);
+    auto lo = _mm256_unpacklo_epi16(bg, ra);
+    auto hi = _mm256_unpackhi_epi16(bg, ra);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * x),
+                        _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * x + 32),
+                        _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  bgraRowSSE2(y, u, v, dst, x, width);
+}
+
+#endif // __GNUC__ || __clang__
+
+#endif // PLAYER_COLOR_X86
+
+#ifdef PLAYER_COLOR_NEON
+
+template <bool NV12>
+static void yuyvPairNEON(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                         uint8_t *u, uint8_t *v, int x, int width) {
+  if (!y1) {
+    yuyvPairScalar<NV12>(s0, s1, y0, y1, u, v, x, width);
+    return;
+  }
+  for (; x + 32 <= width; x += 32) {
+    // y0 u y1 v of 16 pixel pairs
+    auto a = vld4q_u8(s0 + 2 * x);
+    auto b = vld4q_u8(s1 + 2 * x);
+    vst2q_u8(y0 + x, (uint8x16x2_t){{a.val[0], a.val[2]}});
+    vst2q_u8(y1 + x, (uint8x16x2_t){{b.val[0], b.val[2]}});
+    auto cu = vrhaddq_u8(a.val[1], b.val[1]);
+    auto cv = vrhaddq_u8(a.val[3], b.val[3]);
+    if (NV12) {
+      vst2q_u8(u + x, (uint8x16x2_t){{cu, cv}});
+    } else {
+      vst1q_u8(u + x / 2, cu);
+      vst1q_u8(v + x / 2, cv);
+    }
+  }
+  yuyvPairScalar<NV12>(s0, s1, y0, y1, u, v, x, width);
+}
+
+static inline uint8x8x4_t bgraNEON(uint8x8_t y, uint8x8_t u, uint8x8_t v) {
+  auto luma = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y)), vdupq_n_s16(16)), COLOR_Y);
+  auto cb = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u)), vdupq_n_s16(128));
+  auto cr = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v)), vdupq_n_s16(128));
+  auto round = vdupq_n_s16(32);
+  auto b = vqaddq_s16(vqaddq_s16(luma, vmulq_n_s16(cb, COLOR_BU)), round);
+  auto g = vqsubq_s16(vqsubq_s16(luma, vmulq_n_s16(cb, COLOR_GU)), vmulq_n_s16(cr, COLOR_GV));
+  g = vqaddq_s16(g, round);
+  auto r = vqaddq_s16(vqaddq_s16(luma, vmulq_n_s16(cr, COLOR_RV)), round);
+  return (uint8x8x4_t){{vqshrun_n_s16(b, 6), vqshrun_n_s16(g, 6), vqshrun_n_s16(r, 6),
+                        vdup_n_u8(255)}};
+}
+
+static void bgraRowNEON(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                        int x, int width) {
+  for (; x + 16 <= width; x += 16) {
+    auto luma = vld1q_u8(y + x);
+    // every chroma sample covers two pixels
+    auto cu = vzip_u8(vld1_u8(u + x / 2), vld1_u8(u + x / 2));
+    auto cv = vzip_u8(vld1_u8(v + x / 2), vld1_u8(v + x / 2));
+    vst4_u8(dst + 4 * x, bgraNEON(vget_low_u8(luma), cu.val[0], cv.val[0]));
+    vst4_u8(dst + 4 * x + 32, bgraNEON(vget_high_u8(luma), cu.val[1], cv.val[1]));
+  }
+  bgraRowScalar(y, u, v, dst, x, width);
+}
+
+#endif // PLAYER_COLOR_NEON
+
+#define KERNELS(NAME, SUFFIX)                                                                      \
+  Player::ColorKernels {                                                                           \
+    NAME,                                                                                          \
+        [](const uint8_t *src, int srcStride, uint8_t *y, int yStride, uint8_t *u, int uStride,    \
+           uint8_t *v, int vStride, int width, int height) {                                       \
+          yuyvFrame<yuyvPair##SUFFIX<false>>(src, srcStride, y, yStride, u, uStride, v, vStride,   \
+                                             width, height);                                       \
+        },                                                                                         \
+        [](const uint8_t *src, int srcStride, uint8_t *y, int yStride, uint8_t *uv, int uvStride,  \
+           int width, int height) {                                                                \
+          yuyvFrame<yuyvPair##SUFFIX<true>>(src, srcStride, y, yStride, uv, uvStride, uv + 1,      \
+                                            uvStride, width, height);                              \
+        },                                                                                         \
+        i420Frame<bgraRow##SUFFIX>                                                                 \
+  }
+
+static Player::ColorKernels detect() {
+#ifdef PLAYER_COLOR_X86
+#ifdef PLAYER_COLOR_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return KERNELS("avx2", AVX2);
+  }
+#endif
+  // every x86_64 CPU has SSE2
+  return KERNELS("sse2", SSE2);
+#elif defined(PLAYER_COLOR_NEON)
+  return KERNELS("neon", NEON);
+#else
+  return Player::scalarColorKernels();
+#endif
+}
+
+const Player::ColorKernels &Player::colorKernels() {
+  static const ColorKernels kernels = detect();
+  return kernels;
+}
+
+const Player::ColorKernels &Player::scalarColorKernels() {
+  static const ColorKernels kernels = KERNELS("scalar", Scalar);
+  return kernels;
+}
+
+bool Player::canConvert(AVPixelFormat src, AVPixelFormat dst) {
+  switch (src) {
+  case AV_PIX_FMT_YUYV422:
+    return dst == AV_PIX_FMT_YUV420P || dst == AV_PIX_FMT_NV12;
+  case AV_PIX_FMT_YUV420P:
+    return dst == AV_PIX_FMT_BGRA;
+  default:
+    return false;
+  }
+}
+
+bool Player::convertFrame(const AVFrame *src, AVFrame *dst, const ColorKernels &kernels) {
+  auto from = (AVPixelFormat)src->format;
+  auto to = (AVPixelFormat)dst->format;
+  if (!canConvert(from, to) || src->width != dst->width || src->height != dst->height) {
+    return false;
+  }
+  if (from == AV_PIX_FMT_YUV420P) {
+    kernels.i420ToBGRA(src->data[0], src->linesize[0], src->data[1], src->linesize[1],
+                       src->data[2], src->linesize[2], dst->data[0], dst->linesize[0], src->width,
+                       src->height);
+  } else if (to == AV_PIX_FMT_NV12) {
+    kernels.yuyvToNV12(src->data[0], src->linesize[0], dst->data[0], dst->linesize[0],
+                       dst->data[1], dst->linesize[1], src->width, src->height);
+  } else {
+    kernels.yuyvToI420(src->data[0], src->linesize[0], dst->data[0], dst->linesize[0],
+                       dst->data[1], dst->linesize[1], dst->data[2], dst->linesize[2],
+                       src->width, src->height);
+  }
+  return true;
+}
@@ -0,0 +1,110 @@
+#include "Utils/file_avio.h"
+
+#include <cstdio>
+
+// avio 内部缓冲区大小，真正的块缓冲在 FileReader/FileWriter 里
+#define FILE_AVIO_SIZE 32768
+
+Player::FileAVIO::~FileAVIO() { close(); }
+
+AVIOContext *Player::FileAVIO::openRead(const std::string &filename) {
+  close();
+  if (!reader_.open(filename)) {
+    return nullptr;
+  }
+  if (!allocContext(false)) {
+    reader_.close();
+  }
+  return ctx_;
+}
+
+AVIOContext *Player::FileAVIO::openWrite(const std::string &filename, int64_t preallocate) {
+  close();
+  if (!writer_.open(filename, preallocate)) {
+    return nullptr;
+  }
+  pos_ = 0;
+  if (!allocContext(true)) {
+    writer_.close();
+  }
+  return ctx_;
+}
+
+void Player::FileAVIO::close() {
+  if (ctx_) {
+    if (ctx_->write_flag) {
+      avio_flush(ctx_);
+    }
+    av_freep(&ctx_->buffer);
+    avio_context_free(&ctx_);
+  }
+  reader_.close();
+  writer_.close();
+}
+
+AVIOContext *Player::FileAVIO::allocContext(bool write) {
+  auto buffer = static_cast<unsigned char *>(av_malloc(FILE_AVIO_SIZE));
+  if (!buffer) {
+    return nullptr;
+  }
+  ctx_ = avio_alloc_context(buffer, FILE_AVIO_SIZE, write ? 1 : 0, this,
+                            write ? nullptr : &readPacket, write ? &writePacket : nullptr, &seek);
+  if (!ctx_) {
+    av_free(buffer);
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call avio_alloc_context");
+  }
+  return ctx_;
+}
+
+int Player::FileAVIO::readPacket(void *opaque, uint8_t *buf, int size) {
+  auto len = static_cast<FileAVIO *>(opaque)->reader_.read(buf, size);
+  return len > 0 ? (int)len : AVERROR_EOF;
+}
+
+#if LIBAVFORMAT_VERSION_MAJOR < 61
+int Player::FileAVIO::writePacket(void *opaque, uint8_t *buf, int size) {
+#else
+int Player::FileAVIO::writePacket(void *opaque, const uint8_t *buf, int size) {
+#endif
+  auto self = static_cast<FileAVIO *>(opaque);
+  auto &writer = self->writer_;
+  // appends go through the block buffers, only patches behind the end are written in place
+  bool ok = self->pos_ == writer.size() ? writer.write(buf, size)
+                                        : writer.writeAt(self->pos_, buf, size);
+  if (!ok) {
+    return AVERROR(EIO);
+  }
+  self->pos_ += size;
+  return size;
+}
+
+int64_t Player::FileAVIO::seek(void *opaque, int64_t offset, int whence) {
+  auto self = static_cast<FileAVIO *>(opaque);
+  bool write = self->writer_.isOpen();
+  auto size = write ? self->writer_.size() : self->reader_.size();
+  auto pos = write ? self->pos_ : self->reader_.tell();
+  switch (whence & ~AVSEEK_FORCE) {
+  case AVSEEK_SIZE:
+    return size;
+  case SEEK_SET:
+    pos = offset;
+    break;
+  case SEEK_CUR:
+    pos += offset;
+    break;
+  case SEEK_END:
+    pos = size + offset;
+    break;
+  default:
+    return AVERROR(EINVAL);
+  }
+  if (pos < 0) {
+    return AVERROR(EINVAL);
+  }
+  if (write) {
+    self->pos_ = pos;
+  } else {
+    self->reader_.seek(pos);
+  }
+  return pos;
+}
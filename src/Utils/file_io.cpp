@@ -0,0 +1,518 @@
+#include "Utils/file_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef PLAYER_IO_URING
+#include <liburing.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+// 队列深度，所有文件共用一个 ring
+#define URING_ENTRIES 64
+
+static int64_t preadAll(int fd, void *data, size_t len, int64_t offset) {
+  auto out = static_cast<Byte *>(data);
+  size_t total = 0;
+#ifdef _WIN32
+  // no pread, the seek and the read must not interleave with another request
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (_lseeki64(fd, offset, SEEK_SET) < 0) {
+    return -errno;
+  }
+#endif
+  while (total < len) {
+#ifdef _WIN32
+    auto n = _read(fd, out + total, (unsigned)(len - total));
+#else
+    auto n = pread(fd, out + total, len - total, (off_t)(offset + total));
+#endif
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return -errno;
+    }
+    if (n == 0) {
+      break;
+    }
+    total += n;
+  }
+  return (int64_t)total;
+}
+
+static int64_t pwriteAll(int fd, const void *data, size_t len, int64_t offset) {
+  auto in = static_cast<const Byte *>(data);
+  size_t total = 0;
+#ifdef _WIN32
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (_lseeki64(fd, offset, SEEK_SET) < 0) {
+    return -errno;
+  }
+#endif
+  while (total < len) {
+#ifdef _WIN32
+    auto n = _write(fd, in + total, (unsigned)(len - total));
+#else
+    auto n = pwrite(fd, in + total, len - total, (off_t)(offset + total));
+#endif
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return n < 0 ? -errno : (int64_t)total;
+    }
+    total += n;
+  }
+  return (int64_t)total;
+}
+
+static void closeFile(int fd) {
+#ifdef _WIN32
+  _close(fd);
+#else
+  ::close(fd);
+#endif
+}
+
+static void logIOError(const std::string &filename, int64_t ret) {
+  av_log(nullptr, AV_LOG_ERROR, "%s: %s\n", filename.c_str(), strerror((int)-ret));
+}
+
+Player::IOBackend &Player::IOBackend::shared() {
+  static std::unique_ptr<IOBackend> backend = [] {
+    auto forced = getenv("PLAYER_IO");
+    bool threads = forced && strcmp(forced, "threads") == 0;
+#ifdef PLAYER_IO_URING
+    if (!threads) {
+      auto uring = std::make_unique<UringIO>();
+      if (uring->isOpen()) {
+        return std::unique_ptr<IOBackend>(std::move(uring));
+      }
+      // seccomp or an old kernel
+      av_log(nullptr, AV_LOG_INFO, "%s\n", "io_uring unavailable, using the thread pool");
+    }
+#endif
+    (void)threads;
+    return std::unique_ptr<IOBackend>(std::make_unique<ThreadIO>());
+  }();
+  return *backend;
+}
+
+std::future<int64_t> Player::ThreadIO::read(int fd, void *data, size_t len, int64_t offset) {
+  auto promise = std::make_shared<std::promise<int64_t>>();
+  auto future = promise->get_future();
+  pool_.submit([=] { promise->set_value(preadAll(fd, data, len, offset)); });
+  return future;
+}
+
+std::future<int64_t> Player::ThreadIO::write(int fd, const void *data, size_t len,
+                                             int64_t offset) {
+  auto promise = std::make_shared<std::promise<int64_t>>();
+  auto future = promise->get_future();
+  pool_.submit([=] { promise->set_value(pwriteAll(fd, data, len, offset)); });
+  return future;
+}
+
+#ifdef PLAYER_IO_URING
+struct Player::UringIO::Ring {
+  io_uring ring{};
+};
+
+Player::UringIO::UringIO() : ring_(new Ring) {
+  if (io_uring_queue_init(URING_ENTRIES, &ring_->ring, 0) < 0) {
+    delete ring_;
+    ring_ = nullptr;
+    return;
+  }
+  open_ = true;
+  reaper_ = std::thread(&Player::UringIO::reap, this);
+}
+
+Player::UringIO::~UringIO() {
+  if (!open_) {
+    return;
+  }
+  {
+    // a request without a promise tells the reaper to leave
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto sqe = io_uring_get_sqe(&ring_->ring);
+    while (!sqe) {
+      io_uring_submit(&ring_->ring);
+      sqe = io_uring_get_sqe(&ring_->ring);
+    }
+    io_uring_prep_nop(sqe);
+    io_uring_sqe_set_data(sqe, nullptr);
+    io_uring_submit(&ring_->ring);
+  }
+  reaper_.join();
+  io_uring_queue_exit(&ring_->ring);
+  delete ring_;
+}
+
+std::future<int64_t> Player::UringIO::read(int fd, void *data, size_t len, int64_t offset) {
+  return submit(false, fd, data, len, offset);
+}
+
+std::future<int64_t> Player::UringIO::write(int fd, const void *data, size_t len,
+                                            int64_t offset) {
+  return submit(true, fd, const_cast<void *>(data), len, offset);
+}
+
+std::future<int64_t> Player::UringIO::submit(bool write, int fd, void *data, size_t len,
+                                             int64_t offset) {
+  auto promise = new std::promise<int64_t>();
+  auto future = promise->get_future();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto sqe = io_uring_get_sqe(&ring_->ring);
+  if (!sqe) {
+    // the submission queue is full, hand what is in it to the kernel first
+    io_uring_submit(&ring_->ring);
+    sqe = io_uring_get_sqe(&ring_->ring);
+  }
+  if (!sqe) {
+    promise->set_value(-EBUSY);
+    delete promise;
+    return future;
+  }
+  if (write) {
+    io_uring_prep_write(sqe, fd, data, (unsigned)len, (uint64_t)offset);
+  } else {
+    io_uring_prep_read(sqe, fd, data, (unsigned)len, (uint64_t)offset);
+  }
+  io_uring_sqe_set_data(sqe, promise);
+  io_uring_submit(&ring_->ring);
+  return future;
+}
+
+void Player::UringIO::reap() {
+  while (true) {
+    io_uring_cqe *cqe = nullptr;
+    int ret = io_uring_wait_cqe(&ring_->ring, &cqe);
+    if (ret == -EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      break;
+    }
+    auto promise = static_cast<std::promise<int64_t> *>(io_uring_cqe_get_data(cqe));
+    int64_t res = cqe->res;
+    io_uring_cqe_seen(&ring_->ring, cqe);
+    if (!promise) {
+      break;
+    }
+    promise->set_value(res);
+    delete promise;
+  }
+}
+#endif
+
+Player::IOBlock::IOBlock() {
+#ifdef _WIN32
+  data = static_cast<Byte *>(_aligned_malloc(Size, Alignment));
+#else
+  void *ptr = nullptr;
+  data = posix_memalign(&ptr, Alignment, Size) == 0 ? static_cast<Byte *>(ptr) : nullptr;
+#endif
+}
+
+Player::IOBlock::~IOBlock() {
+  if (pending.valid()) {
+    pending.wait();
+  }
+#ifdef _WIN32
+  _aligned_free(data);
+#else
+  free(data);
+#endif
+}
+
+Player::FileReader::~FileReader() { close(); }
+
+bool Player::FileReader::open(const std::string &filename, int64_t offset) {
+  close();
+  if (!blocks_[0].data || !blocks_[1].data) {
+    return false;
+  }
+  fd_ = ::open(filename.c_str(), O_RDONLY | O_BINARY);
+  if (fd_ < 0) {
+    av_log(nullptr, AV_LOG_ERROR, "Failed to open %s\n", filename.c_str());
+    return false;
+  }
+  struct stat st {};
+  if (fstat(fd_, &st)) {
+    close();
+    return false;
+  }
+#ifdef __linux__
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  filename_ = filename;
+  size_ = st.st_size;
+  pos_ = std::min<int64_t>(std::max<int64_t>(offset, 0), size_);
+  stats_.reset();
+  return true;
+}
+
+void Player::FileReader::close() {
+  if (fd_ < 0) {
+    return;
+  }
+  for (auto &block : blocks_) {
+    settle(block);
+    block.offset = -1;
+    block.size = 0;
+  }
+  closeFile(fd_);
+  fd_ = -1;
+  stats_.dump(filename_.c_str(), AV_LOG_VERBOSE);
+}
+
+size_t Player::FileReader::read(void *data, size_t len) {
+  auto out = static_cast<Byte *>(data);
+  size_t total = 0;
+  while (fd_ >= 0 && total < len && pos_ < size_) {
+    auto &block = blocks_[current_];
+    if (block.offset < 0 || pos_ < block.offset || pos_ >= block.offset + (int64_t)block.size) {
+      if (!load()) {
+        break;
+      }
+      continue;
+    }
+    auto skip = (size_t)(pos_ - block.offset);
+    auto n = std::min(len - total, block.size - skip);
+    memcpy(out + total, block.data + skip, n);
+    total += n;
+    pos_ += (int64_t)n;
+  }
+  return total;
+}
+
+void Player::FileReader::seek(int64_t position) {
+  pos_ = std::min<int64_t>(std::max<int64_t>(position, 0), size_);
+}
+
+int64_t Player::FileReader::readAt(int64_t offset, void *data, size_t len) {
+  if (fd_ < 0) {
+    return -1;
+  }
+  auto begin = av_gettime_relative();
+  auto ret = backend_.read(fd_, data, len, offset).get();
+  auto waited = av_gettime_relative() - begin;
+  stats_.requests++;
+  stats_.stalled += waited;
+  stats_.latency.add(waited);
+  if (ret < 0) {
+    logIOError(filename_, ret);
+    return ret;
+  }
+  stats_.bytesRead += ret;
+  return ret;
+}
+
+bool Player::FileReader::load() {
+  auto &next = blocks_[current_ ^ 1];
+  settle(next);
+  if (next.offset >= 0 && pos_ >= next.offset && pos_ < next.offset + (int64_t)next.size) {
+    // the read-ahead paid off
+    current_ ^= 1;
+  } else {
+    // a seek, or the first read: start on an aligned offset
+    auto &block = blocks_[current_];
+    prefetch(block, pos_ - pos_ % (int64_t)IOBlock::Alignment);
+    settle(block);
+    if (pos_ >= block.offset + (int64_t)block.size) {
+      return false;
+    }
+  }
+  auto &block = blocks_[current_];
+  auto following = block.offset + (int64_t)block.size;
+  if (following < size_) {
+    prefetch(blocks_[current_ ^ 1], following);
+  }
+  return true;
+}
+
+void Player::FileReader::prefetch(IOBlock &block, int64_t offset) {
+  settle(block);
+  block.offset = offset;
+  block.size = 0;
+  auto len = (size_t)std::min<int64_t>(IOBlock::Size, size_ - offset);
+  block.submitted = av_gettime_relative();
+  block.pending = backend_.read(fd_, block.data, len, offset);
+  stats_.requests++;
+}
+
+int64_t Player::FileReader::settle(IOBlock &block) {
+  if (!block.pending.valid()) {
+    return (int64_t)block.size;
+  }
+  auto begin = av_gettime_relative();
+  auto ret = block.pending.get();
+  auto end = av_gettime_relative();
+  stats_.stalled += end - begin;
+  stats_.latency.add(end - block.submitted);
+  if (ret < 0) {
+    logIOError(filename_, ret);
+    ret = 0;
+  }
+  block.size = (size_t)ret;
+  stats_.bytesRead += ret;
+  return ret;
+}
+
+Player::FileWriter::~FileWriter() { close(); }
+
+bool Player::FileWriter::open(const std::string &filename, int64_t preallocate, bool truncate) {
+  close();
+  if (!blocks_[0].data || !blocks_[1].data) {
+    return false;
+  }
+  fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_BINARY | (truncate ? O_TRUNC : 0), 0644);
+  if (fd_ < 0) {
+    av_log(nullptr, AV_LOG_ERROR, "Failed to open %s\n", filename.c_str());
+    return false;
+  }
+  filename_ = filename;
+  size_ = 0;
+  preallocated_ = 0;
+  failed_ = false;
+  current_ = 0;
+  stats_.reset();
+#ifdef __linux__
+  // a failed reservation only costs the contiguous layout
+  if (preallocate > 0 && posix_fallocate(fd_, 0, (off_t)preallocate) == 0) {
+    preallocated_ = preallocate;
+  }
+#else
+  (void)preallocate;
+#endif
+  return true;
+}
+
+void Player::FileWriter::close() {
+  if (fd_ < 0) {
+    return;
+  }
+  flush();
+#ifdef __linux__
+  // give back what the preallocation reserved past the end
+  if (preallocated_ > size_ && ftruncate(fd_, (off_t)size_) != 0) {
+    logIOError(filename_, -errno);
+  }
+#endif
+  closeFile(fd_);
+  fd_ = -1;
+  stats_.dump(filename_.c_str(), AV_LOG_VERBOSE);
+}
+
+bool Player::FileWriter::write(const void *data, size_t len) {
+  if (fd_ < 0 || failed_) {
+    return false;
+  }
+  auto in = static_cast<const Byte *>(data);
+  while (len > 0) {
+    auto &block = blocks_[current_];
+    if (block.offset < 0) {
+      block.offset = size_;
+      block.size = 0;
+    }
+    auto n = std::min(len, IOBlock::Size - block.size);
+    memcpy(block.data + block.size, in, n);
+    block.size += n;
+    size_ += (int64_t)n;
+    in += n;
+    len -= n;
+    if (block.size == IOBlock::Size) {
+      // this one goes to the disk, the other must be done before it is filled again
+      current_ ^= 1;
+      if (!submit(block) || !settle(blocks_[current_])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Player::FileWriter::writeAt(int64_t offset, const void *data, size_t len) {
+  if (!flush() || len == 0) {
+    return len == 0 && !failed_;
+  }
+  auto pending = backend_.write(fd_, data, len, offset);
+  stats_.requests++;
+  if (!complete(pending, static_cast<const Byte *>(data), len, offset)) {
+    return false;
+  }
+  size_ = std::max(size_, offset + (int64_t)len);
+  return true;
+}
+
+bool Player::FileWriter::flush() {
+  if (fd_ < 0) {
+    return false;
+  }
+  auto &block = blocks_[current_];
+  if (block.offset >= 0 && block.size > 0) {
+    submit(block);
+  }
+  bool ok = settle(blocks_[0]);
+  ok = settle(blocks_[1]) && ok;
+  return ok && !failed_;
+}
+
+bool Player::FileWriter::submit(IOBlock &block) {
+  block.submitted = av_gettime_relative();
+  block.pending = backend_.write(fd_, block.data, block.size, block.offset);
+  stats_.requests++;
+  return true;
+}
+
+bool Player::FileWriter::settle(IOBlock &block) {
+  if (!block.pending.valid()) {
+    return true;
+  }
+  bool ok = complete(block.pending, block.data, block.size, block.offset);
+  stats_.latency.add(av_gettime_relative() - block.submitted);
+  block.offset = -1;
+  block.size = 0;
+  return ok;
+}
+
+bool Player::FileWriter::complete(std::future<int64_t> &pending, const Byte *data, size_t len,
+                                  int64_t offset) {
+  size_t done = 0;
+  while (true) {
+    auto begin = av_gettime_relative();
+    auto ret = pending.get();
+    stats_.stalled += av_gettime_relative() - begin;
+    if (ret <= 0) {
+      logIOError(filename_, ret < 0 ? ret : -EIO);
+      failed_ = true;
+      return false;
+    }
+    stats_.bytesWritten += ret;
+    done += (size_t)ret;
+    if (done >= len) {
+      return true;
+    }
+    pending = backend_.write(fd_, data + done, len - done, offset + (int64_t)done);
+    stats_.requests++;
+  }
+}
@@ -0,0 +1,42 @@
+#include "Utils/frame_decimator.h"
+
+bool Player::FrameDecimator::keep(size_t queued, size_t capacity) {
+  last_ = av_gettime_relative();
+  if (seen_++ == 0) {
+    begin_ = last_;
+  }
+
+  auto second = (int64_t)std::max(1.0, requestedRate());
+  if (++held_ >= second) {
+    if (queued * 2 > capacity && level_ > 1) {
+      level_--;
+      held_ = 0;
+    } else if (queued * 4 < capacity && level_ < Steps) {
+      level_++;
+      held_ = 0;
+    }
+  }
+
+  // keeps level_ of every Steps frames, spread out evenly
+  accumulator_ += level_;
+  if (accumulator_ < Steps) {
+    return false;
+  }
+  accumulator_ -= Steps;
+  kept_++;
+  return true;
+}
+
+double Player::FrameDecimator::requestedRate() const {
+  return frameRate_.num > 0 && frameRate_.den > 0 ? av_q2d(frameRate_) : 0;
+}
+
+double Player::FrameDecimator::effectiveRate() const {
+  auto elapsed = (double)(last_ - begin_) / AV_TIME_BASE;
+  return elapsed > 0 && kept_ > 1 ? (double)(kept_ - 1) / elapsed : 0;
+}
+
+void Player::FrameDecimator::dump() const {
+  av_log(nullptr, AV_LOG_INFO, "frames=%lld dropped=%lld requested=%.2f fps effective=%.2f fps\n",
+         (long long)seen_, (long long)dropped(), requestedRate(), effectiveRate());
+}
@@ -0,0 +1,90 @@
+#include "Utils/frame_pool.h"
+
+// 行对齐字节数，满足 SIMD 读写
+#define FRAME_POOL_ALIGN 32
+// 最多保留的空闲 AVFrame
+#define FRAME_POOL_SHELLS 16
+
+Player::FramePool::~FramePool() { close(); }
+
+bool Player::FramePool::init(AVPixelFormat format, int width, int height) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pool_ && format == format_ && width == width_ && height == height_) {
+    return true;
+  }
+  // buffers still out keep the old pool alive until they come back
+  av_buffer_pool_uninit(&pool_);
+  int size = av_image_get_buffer_size(format, width, height, FRAME_POOL_ALIGN);
+  if (size < 0) {
+    log_error(size);
+    return false;
+  }
+  pool_ = av_buffer_pool_init2(size, this, allocate, nullptr);
+  if (!pool_) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call av_buffer_pool_init2");
+    return false;
+  }
+  format_ = format;
+  width_ = width;
+  height_ = height;
+  return true;
+}
+
+void Player::FramePool::close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  av_buffer_pool_uninit(&pool_);
+  for (auto &frame : shells_) {
+    av_frame_free(&frame);
+  }
+  shells_.clear();
+}
+
+#if LIBAVUTIL_VERSION_MAJOR < 57
+AVBufferRef *Player::FramePool::allocate(void *opaque, int size) {
+#else
+AVBufferRef *Player::FramePool::allocate(void *opaque, size_t size) {
+#endif
+  // only called when nothing idle is left in the pool
+  static_cast<FramePool *>(opaque)->stats_.allocated++;
+  return av_buffer_alloc(size);
+}
+
+AVFrame *Player::FramePool::acquire() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!pool_) {
+    return nullptr;
+  }
+  stats_.requests++;
+  AVFrame *frame = nullptr;
+  if (!shells_.empty()) {
+    frame = shells_.back();
+    shells_.pop_back();
+  } else if (!(frame = av_frame_alloc())) {
+    return nullptr;
+  }
+  if (!(frame->buf[0] = av_buffer_pool_get(pool_))) {
+    av_frame_free(&frame);
+    return nullptr;
+  }
+  frame->format = format_;
+  frame->width = width_;
+  frame->height = height_;
+  av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data, format_, width_,
+                       height_, FRAME_POOL_ALIGN);
+  return frame;
+}
+
+void Player::FramePool::release(AVFrame *frame) {
+  if (!frame) {
+    return;
+  }
+  av_frame_unref(frame);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (shells_.size() >= FRAME_POOL_SHELLS) {
+    stats_.discarded++;
+    av_frame_free(&frame);
+    return;
+  }
+  stats_.recycled++;
+  shells_.push_back(frame);
+}
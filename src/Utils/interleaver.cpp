@@ -0,0 +1,45 @@
+#include "Utils/interleaver.h"
+
+Player::Interleaver::~Interleaver() { swr_free(&swr_); }
+
+bool Player::Interleaver::init(const AVFrame *frame) {
+  auto fmt = (AVSampleFormat)frame->format;
+  fmt_ = av_get_packed_sample_fmt(fmt);
+  if (fmt_ != AV_SAMPLE_FMT_U8 && fmt_ != AV_SAMPLE_FMT_S16 && fmt_ != AV_SAMPLE_FMT_S32 &&
+      fmt_ != AV_SAMPLE_FMT_FLT) {
+    fmt_ = AV_SAMPLE_FMT_FLT;
+  }
+  frameSize_ = av_get_bytes_per_sample(fmt_) * frame->ch_layout.nb_channels;
+  if (fmt_ == fmt) {
+    return true;
+  }
+  int ret = swr_alloc_set_opts2(&swr_, &frame->ch_layout, fmt_, frame->sample_rate,
+                                &frame->ch_layout, fmt, frame->sample_rate, 0, nullptr);
+  if (ret < 0 || (ret = swr_init(swr_)) < 0) {
+    log_error(ret);
+    return false;
+  }
+  return true;
+}
+
+bool Player::Interleaver::convert(const AVFrame *frame, const Byte *&data, size_t &len) {
+  if (fmt_ == AV_SAMPLE_FMT_NONE && !init(frame)) {
+    return false;
+  }
+  if (!swr_) {
+    data = frame->data[0];
+    len = (size_t)frame->nb_samples * frameSize_;
+    return true;
+  }
+  buffer_.resize((size_t)frame->nb_samples * frameSize_);
+  auto out = buffer_.data();
+  int ret = swr_convert(swr_, &out, frame->nb_samples, (const uint8_t **)frame->extended_data,
+                        frame->nb_samples);
+  if (ret < 0) {
+    log_error(ret);
+    return false;
+  }
+  data = buffer_.data();
+  len = (size_t)ret * frameSize_;
+  return true;
+}
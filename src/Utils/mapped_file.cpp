@@ -0,0 +1,87 @@
+#include "Utils/mapped_file.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Player::MappedFile::~MappedFile() { close(); }
+
+bool Player::MappedFile::open(const std::string &filename, size_t offset) {
+  close();
+#ifdef _WIN32
+  // callers fall back to the buffered reader
+  return false;
+#else
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    av_log(nullptr, AV_LOG_ERROR, "Failed to open %s\n", filename.c_str());
+    return false;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) || st.st_size <= (off_t)offset) {
+    ::close(fd);
+    return false;
+  }
+  auto addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    av_log(nullptr, AV_LOG_ERROR, "Failed to call mmap\n");
+    return false;
+  }
+  madvise(addr, st.st_size, MADV_SEQUENTIAL);
+  data_ = static_cast<Byte *>(addr);
+  size_ = st.st_size;
+  offset_ = offset;
+  pos_ = 0;
+  prefetched_ = 0;
+  return true;
+#endif
+}
+
+void Player::MappedFile::close() {
+#ifndef _WIN32
+  if (data_) {
+    munmap(data_, size_);
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+  offset_ = 0;
+  pos_ = 0;
+}
+
+size_t Player::MappedFile::read(Byte *data, size_t len) {
+  auto pos = pos_.load(std::memory_order_relaxed);
+  len = std::min(len, size() - pos);
+  if (len < 1) {
+    return 0;
+  }
+  memcpy(data, this->data() + pos, len);
+  pos_.store(pos + len, std::memory_order_release);
+  return len;
+}
+
+void Player::MappedFile::seek(size_t position) {
+  position = std::min(position, size());
+  pos_.store(position, std::memory_order_release);
+  prefetched_ = offset_ + position;
+}
+
+void Player::MappedFile::prefetch(size_t window) {
+#ifndef _WIN32
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  auto begin = std::max(offset_ + position(), prefetched_);
+  auto end = std::min(offset_ + position() + window, size_);
+  if (begin >= end) {
+    return;
+  }
+  // madvise wants a page aligned address
+  auto aligned = begin & ~(pageSize - 1);
+  madvise(data_ + aligned, end - aligned, MADV_WILLNEED);
+  prefetched_ = end;
+#endif
+}
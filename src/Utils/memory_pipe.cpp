@@ -0,0 +1,106 @@
+#include "Utils/memory_pipe.h"
+
+#include <algorithm>
+#include <cstring>
+
+// avio 内部缓冲区大小
+#define MEMORY_PIPE_IO_SIZE 32768
+
+Player::MemoryPipe::MemoryPipe(size_t chunks) : chunks_(chunks) {}
+
+Player::MemoryPipe::~MemoryPipe() {
+  chunks_.abort();
+  for (auto ctx : {&writer_, &reader_}) {
+    if (*ctx) {
+      av_freep(&(*ctx)->buffer);
+      avio_context_free(ctx);
+    }
+  }
+}
+
+bool Player::MemoryPipe::tee(const std::string &filename) { return tee_.open(filename); }
+
+bool Player::MemoryPipe::write(const Byte *data, size_t len) {
+  if (len < 1) {
+    return true;
+  }
+  if (tee_.isOpen()) {
+    tee_.write(data, len);
+  }
+  bytes_ += len;
+  return chunks_.push(std::vector<Byte>(data, data + len));
+}
+
+size_t Player::MemoryPipe::read(Byte *data, size_t len) {
+  size_t total = 0;
+  while (total < len) {
+    if (pos_ >= current_.size()) {
+      // hand back what there is rather than wait with data in hand
+      if (total > 0 && !chunks_.tryPop(current_)) {
+        break;
+      }
+      if (total == 0 && !chunks_.pop(current_)) {
+        break;
+      }
+      pos_ = 0;
+      continue;
+    }
+    auto n = std::min(len - total, current_.size() - pos_);
+    memcpy(data + total, current_.data() + pos_, n);
+    pos_ += n;
+    total += n;
+  }
+  return total;
+}
+
+void Player::MemoryPipe::finish() {
+  if (writer_) {
+    avio_flush(writer_);
+  }
+  tee_.close();
+  chunks_.finish();
+}
+
+void Player::MemoryPipe::abort() { chunks_.abort(); }
+
+AVIOContext *Player::MemoryPipe::writer() {
+  if (!writer_) {
+    writer_ = allocContext(this, true);
+  }
+  return writer_;
+}
+
+AVIOContext *Player::MemoryPipe::reader() {
+  if (!reader_) {
+    reader_ = allocContext(this, false);
+  }
+  return reader_;
+}
+
+AVIOContext *Player::MemoryPipe::allocContext(MemoryPipe *pipe, bool write) {
+  auto buffer = static_cast<unsigned char *>(av_malloc(MEMORY_PIPE_IO_SIZE));
+  if (!buffer) {
+    return nullptr;
+  }
+  auto ctx = avio_alloc_context(buffer, MEMORY_PIPE_IO_SIZE, write ? 1 : 0, pipe,
+                                write ? nullptr : &readPacket, write ? &writePacket : nullptr,
+                                nullptr);
+  if (!ctx) {
+    av_free(buffer);
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call avio_alloc_context");
+  }
+  return ctx;
+}
+
+int Player::MemoryPipe::readPacket(void *opaque, uint8_t *buf, int size) {
+  auto len = static_cast<MemoryPipe *>(opaque)->read(buf, size);
+  return len > 0 ? (int)len : AVERROR_EOF;
+}
+
+#if LIBAVFORMAT_VERSION_MAJOR < 61
+int Player::MemoryPipe::writePacket(void *opaque, uint8_t *buf, int size) {
+#else
+int Player::MemoryPipe::writePacket(void *opaque, const uint8_t *buf, int size) {
+#endif
+  return static_cast<MemoryPipe *>(opaque)->write(buf, size) ? size : AVERROR_EXIT;
+}
@@ -0,0 +1,298 @@
+#include "Utils/mix_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PLAYER_MIX_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PLAYER_MIX_NEON 1
+#include <arm_neon.h>
+#endif
+
+// the vector paths only handle layouts where a register holds whole frames
+#define WHOLE_FRAMES(lanes, channels) ((channels) > 0 && (lanes) % (channels) == 0)
+
+static inline int16_t saturate16(int value) {
+  return (int16_t)std::clamp(value, (int)INT16_MIN, (int)INT16_MAX);
+}
+
+static void mixS16Scalar(int16_t *dst, const int16_t *src, int frames, int channels, float gain,
+                         float step, int first) {
+  for (int f = 0; f < frames; ++f) {
+    auto g = gain + step * (float)(first + f);
+    for (int c = 0; c < channels; ++c, ++dst, ++src) {
+      // same order as the vector paths: saturate the scaled sample, then the sum
+      *dst = saturate16(*dst + saturate16((int)std::nearbyint(*src * g)));
+    }
+  }
+}
+
+static void mixF32Scalar(float *dst, const float *src, int frames, int channels, float gain,
+                         float step, int first) {
+  for (int f = 0; f < frames; ++f) {
+    auto g = gain + step * (float)(first + f);
+    for (int c = 0; c < channels; ++c) {
+      *dst++ += *src++ * g;
+    }
+  }
+}
+
+static void clipF32Scalar(float *data, int count) {
+  for (int i = 0; i < count; ++i) {
+    data[i] = std::clamp(data[i], -1.0f, 1.0f);
+  }
+}
+
+#ifdef PLAYER_MIX_X86
+
+// frame index of every lane, e.g. {0, 0, 1, 1} for stereo
+static inline __m128 laneFrames128(int channels) {
+  return _mm_setr_ps((float)(0 / channels), (float)(1 / channels), (float)(2 / channels),
+                     (float)(3 / channels));
+}
+
+static void mixS16SSE2(int16_t *dst, const int16_t *src, int frames, int channels, float gain,
+                       float step, int first) {
+  if (!WHOLE_FRAMES(8, channels)) {
+    mixS16Scalar(dst, src, frames, channels, gain, step, first);
+    return;
+  }
+  int count = frames * channels;
+  int perVector = 4 / channels;
+  auto lanes = laneFrames128(channels);
+  auto vgain = _mm_set1_ps(gain);
+  auto vstep = _mm_set1_ps(step);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    auto f = _mm_add_ps(_mm_set1_ps((float)(first + i / channels)), lanes);
+    auto g0 = _mm_add_ps(vgain, _mm_mul_ps(vstep, f));
+    auto g1 = _mm_add_ps(vgain,
+                         _mm_mul_ps(vstep, _mm_add_ps(f, _mm_set1_ps((float)perVector))));
+    auto s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    // sign extend to 32 bit
+    auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+    auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+    lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(lo), g0));
+    hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(hi), g1));
+    auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+    d = _mm_adds_epi16(d, _mm_packs_epi32(lo, hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), d);
+  }
+  int done = i / channels;
+  mixS16Scalar(dst + i, src + i, frames - done, channels, gain, step, first + done);
+}
+
+static void mixF32SSE2(float *dst, const float *src, int frames, int channels, float gain,
+                       float step, int first) {
+  if (!WHOLE_FRAMES(4, channels)) {
+    mixF32Scalar(dst, src, frames, channels, gain, step, first);
+    return;
+  }
+  int count = frames * channels;
+  auto lanes = laneFrames128(channels);
+  auto vgain = _mm_set1_ps(gain);
+  auto vstep = _mm_set1_ps(step);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    auto f = _mm_add_ps(_mm_set1_ps((float)(first + i / channels)), lanes);
+    auto g = _mm_add_ps(vgain, _mm_mul_ps(vstep, f));
+    auto d = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g));
+    _mm_storeu_ps(dst + i, d);
+  }
+  int done = i / channels;
+  mixF32Scalar(dst + i, src + i, frames - done, channels, gain, step, first + done);
+}
+
+static void clipF32SSE2(float *data, int count) {
+  auto lo = _mm_set1_ps(-1.0f);
+  auto hi = _mm_set1_ps(1.0f);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(data + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(data + i), lo), hi));
+  }
+  clipF32Scalar(data + i, count - i);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PLAYER_MIX_AVX2 1
+
+__attribute__((target("avx2"))) static inline __m256 laneFrames256(int channels) {
+  return _mm256_setr_ps((float)(0 / channels), (float)(1 / channels), (float)(2 / channels),
+                        (float)(3 / channels), (float)(4 / channels), (float)(5 / channels),
+                        (float)(6 / channels), (float)(7 / channels));
+}
+
+__attribute__((target("avx2"))) static void mixS16AVX2(int16_t *dst, const int16_t *src,
+                                                       int frames, int channels, float gain,
+                                                       float step, int first) {
+  if (!WHOLE_FRAMES(16, channels)) {
+    mixS16SSE2(dst, src, frames, channels, gain, step, first);
+    return;
+  }
+  int count = frames * channels;
+  int perVector = 8 / channels;
+  auto lanes = laneFrames256(channels);
+  auto vgain = _mm256_set1_ps(gain);
+  auto vstep = _mm256_set1_ps(step);
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    auto f = _mm256_add_ps(_mm256_set1_ps((float)(first + i / channels)), lanes);
+    auto g0 = _mm256_add_ps(vgain, _mm256_mul_ps(vstep, f));
+    auto g1 = _mm256_add_ps(
+        vgain, _mm256_mul_ps(vstep, _mm256_add_ps(f, _mm256_set1_ps((float)perVector))));
+    auto s0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    auto s1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8));
+    auto lo = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s0)), g0));
+    auto hi = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s1)), g1));
+    // packs works per 128 bit lane, put the quarters back in order
+    auto packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+    auto d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_adds_epi16(d, packed));
+  }
+  int done = i / channels;
+  mixS16SSE2(dst + i, src + i, frames - done, channels, gain, step, first + done);
+}
+
+__attribute__((target("avx2"))) static void mixF32AVX2(float *dst, const float *src, int frames,
+                                                       int channels, float gain, float step,
+                                                       int first) {
+  if (!WHOLE_FRAMES(8, channels)) {
+    mixF32SSE2(dst, src, frames, channels, gain, step, first);
+    return;
+  }
+  int count = frames * channels;
+  auto lanes = laneFrames256(channels);
+  auto vgain = _mm256_set1_ps(gain);
+  auto vstep = _mm256_set1_ps(step);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    auto f = _mm256_add_ps(_mm256_set1_ps((float)(first + i / channels)), lanes);
+    auto g = _mm256_add_ps(vgain, _mm256_mul_ps(vstep, f));
+    auto d = _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+    _mm256_storeu_ps(dst + i, d);
+  }
+  int done = i / channels;
+  mixF32SSE2(dst + i, src + i, frames - done, channels, gain, step, first + done);
+}
+
+__attribute__((target("avx2"))) static void clipF32AVX2(float *data, int count) {
+  auto lo = _mm256_set1_ps(-1.0f);
+  auto hi = _mm256_set1_ps(1.0f);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(data + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(data + i), lo), hi));
+  }
+  clipF32SSE2(data + i, count - i);
+}
+
+#endif // __GNUC__ || __clang__
+
+#endif // PLAYER_MIX_X86
+
+#ifdef PLAYER_MIX_NEON
+
+static inline float32x4_t laneFramesNEON(int channels) {
+  float lanes[4] = {(float)(0 / channels), (float)(1 / channels), (float)(2 / channels),
+                    (float)(3 / channels)};
+  return vld1q_f32(lanes);
+}
+
+static void mixS16NEON(int16_t *dst, const int16_t *src, int frames, int channels, float gain,
+                       float step, int first) {
+  if (!WHOLE_FRAMES(8, channels)) {
+    mixS16Scalar(dst, src, frames, channels, gain, step, first);
+    return;
+  }
+  int count = frames * channels;
+  int perVector = 4 / channels;
+  auto lanes = laneFramesNEON(channels);
+  auto vgain = vdupq_n_f32(gain);
+  auto vstep = vdupq_n_f32(step);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    auto f = vaddq_f32(vdupq_n_f32((float)(first + i / channels)), lanes);
+    auto g0 = vaddq_f32(vgain, vmulq_f32(vstep, f));
+    auto g1 = vaddq_f32(vgain, vmulq_f32(vstep, vaddq_f32(f, vdupq_n_f32((float)perVector))));
+    auto s = vld1q_s16(src + i);
+    auto lo = vcvtnq_s32_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), g0));
+    auto hi = vcvtnq_s32_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), g1));
+    auto packed = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+    vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), packed));
+  }
+  int done = i / channels;
+  mixS16Scalar(dst + i, src + i, frames - done, channels, gain, step, first + done);
+}
+
+static void mixF32NEON(float *dst, const float *src, int frames, int channels, float gain,
+                       float step, int first) {
+  if (!WHOLE_FRAMES(4, channels)) {
+    mixF32Scalar(dst, src, frames, channels, gain, step, first);
+    return;
+  }
+  int count = frames * channels;
+  auto lanes = laneFramesNEON(channels);
+  auto vgain = vdupq_n_f32(gain);
+  auto vstep = vdupq_n_f32(step);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    auto f = vaddq_f32(vdupq_n_f32((float)(first + i / channels)), lanes);
+    auto g = vaddq_f32(vgain, vmulq_f32(vstep, f));
+    vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vmulq_f32(vld1q_f32(src + i), g)));
+  }
+  int done = i / channels;
+  mixF32Scalar(dst + i, src + i, frames - done, channels, gain, step, first + done);
+}
+
+static void clipF32NEON(float *data, int count) {
+  auto lo = vdupq_n_f32(-1.0f);
+  auto hi = vdupq_n_f32(1.0f);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    vst1q_f32(data + i, vminq_f32(vmaxq_f32(vld1q_f32(data + i), lo), hi));
+  }
+  clipF32Scalar(data + i, count - i);
+}
+
+#endif // PLAYER_MIX_NEON
+
+// the table entries always start at frame 0
+#define KERNELS(NAME, SUFFIX)                                                                      \
+  Player::MixKernels {                                                                             \
+    NAME,                                                                                          \
+        [](int16_t *dst, const int16_t *src, int frames, int channels, float gain, float step) {  \
+          mixS16##SUFFIX(dst, src, frames, channels, gain, step, 0);                               \
+        },                                                                                         \
+        [](float *dst, const float *src, int frames, int channels, float gain, float step) {      \
+          mixF32##SUFFIX(dst, src, frames, channels, gain, step, 0);                               \
+        },                                                                                         \
+        clipF32##SUFFIX                                                                            \
+  }
+
+static Player::MixKernels detect() {
+#ifdef PLAYER_MIX_X86
+#ifdef PLAYER_MIX_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return KERNELS("avx2", AVX2);
+  }
+#endif
+  // every x86_64 CPU has SSE2
+  return KERNELS("sse2", SSE2);
+#elif defined(PLAYER_MIX_NEON)
+  return KERNELS("neon", NEON);
+#else
+  return Player::scalarMixKernels();
+#endif
+}
+
+const Player::MixKernels &Player::mixKernels() {
+  static const MixKernels kernels = detect();
+  return kernels;
+}
+
+const Player::MixKernels &Player::scalarMixKernels() {
+  static const MixKernels kernels = KERNELS("scalar", Scalar);
+  return kernels;
+}
@@ -0,0 +1,44 @@
+#include "Utils/packet_queue.h"
+
+bool Player::CaptureQueue::offer(AVPacket *pkt) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stats_.packets.fetch_add(1, std::memory_order_relaxed);
+  if (overflow_ == Overflow::Block) {
+    notFull_.wait(lock, [this] { return aborted_ || items_.size() < capacity_; });
+  }
+  if (aborted_) {
+    av_packet_free(&pkt);
+    return false;
+  }
+  if (items_.size() >= capacity_) {
+    if (overflow_ == Overflow::DropNewest) {
+      drop(pkt);
+      return true;
+    }
+    auto oldest = items_.front();
+    items_.pop_front();
+    stats_.queuedBytes -= oldest->size;
+    drop(oldest);
+  }
+  auto queued = stats_.queuedBytes += pkt->size;
+  if (queued > stats_.highWater) {
+    stats_.highWater = queued;
+  }
+  items_.push_back(pkt);
+  notEmpty_.notify_one();
+  return true;
+}
+
+bool Player::CaptureQueue::take(AVPacket *&pkt) {
+  if (!pop(pkt)) {
+    return false;
+  }
+  stats_.queuedBytes -= pkt->size;
+  return true;
+}
+
+void Player::CaptureQueue::drop(AVPacket *pkt) {
+  stats_.drops.fetch_add(1, std::memory_order_relaxed);
+  stats_.droppedBytes.fetch_add(pkt->size, std::memory_order_relaxed);
+  av_packet_free(&pkt);
+}
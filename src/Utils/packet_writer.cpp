@@ -0,0 +1,32 @@
+#include "Utils/packet_writer.h"
+
+#include <chrono>
+
+Player::PacketWriter::~PacketWriter() {
+  queue_.abort();
+  stop();
+}
+
+void Player::PacketWriter::start(Write write) {
+  write_ = std::move(write);
+  thread_ = std::thread(&Player::PacketWriter::run, this);
+}
+
+void Player::PacketWriter::stop() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void Player::PacketWriter::run() {
+  using namespace std::chrono;
+  auto &stats = queue_.stats();
+  AVPacket *pkt = nullptr;
+  while (queue_.take(pkt)) {
+    stats.depth.add(queue_.size());
+    auto begin = steady_clock::now();
+    write_(pkt);
+    stats.write.add(duration_cast<microseconds>(steady_clock::now() - begin).count());
+    av_packet_free(&pkt);
+  }
+}
@@ -0,0 +1,48 @@
+#include "Utils/pipeline.h"
+
+#include <thread>
+#include <vector>
+
+void Player::Pipeline::add(const std::string &name, Body body) {
+  auto &stage = stages_.emplace_back();
+  stage.name_ = name;
+  stage.body_ = std::move(body);
+}
+
+bool Player::Pipeline::run() {
+  std::vector<std::thread> threads;
+  begin_ = av_gettime_relative();
+  for (auto &stage : stages_) {
+    threads.emplace_back([&stage] {
+      stage.waited_ = 0;
+      stage.begin_ = av_gettime_relative();
+      stage.success_ = stage.body_(stage);
+      stage.end_ = av_gettime_relative();
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  end_ = av_gettime_relative();
+  bool success = true;
+  for (auto &stage : stages_) {
+    success = success && stage.success_;
+  }
+  return success;
+}
+
+void Player::Pipeline::report() const {
+  int64_t busy = 0;
+  for (auto &stage : stages_) {
+    auto working = stage.end_ - stage.begin_ - stage.waited_;
+    busy += working;
+    av_log(nullptr, AV_LOG_INFO, "%-10s %8.1f -> %8.1f ms, working %8.1f ms%s\n",
+           stage.name_.c_str(), (double)(stage.begin_ - begin_) / 1000,
+           (double)(stage.end_ - begin_) / 1000, (double)working / 1000,
+           stage.success_ ? "" : ", failed");
+  }
+  auto wall = std::max<int64_t>(end_ - begin_, 1);
+  // one after another the run would take about `busy`, 1x means the stages never overlapped
+  av_log(nullptr, AV_LOG_INFO, "wall %.1f ms against %.1f ms of work, overlap %.2fx\n",
+         (double)wall / 1000, (double)busy / 1000, (double)busy / (double)wall);
+}
@@ -0,0 +1,77 @@
+#include "Utils/ring_buffer.h"
+
+#include <chrono>
+
+Player::RingBuffer::RingBuffer(size_t capacity) { reset(capacity); }
+
+Player::RingBuffer::~RingBuffer() { delete[] data_; }
+
+void Player::RingBuffer::reset(size_t capacity) {
+  delete[] data_;
+  data_ = capacity > 0 ? new Byte[capacity] : nullptr;
+  capacity_ = capacity;
+  head_ = 0;
+  tail_ = 0;
+}
+
+void Player::RingBuffer::clear() { tail_.store(head_.load(std::memory_order_acquire)); }
+
+size_t Player::RingBuffer::size() const {
+  return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+}
+
+size_t Player::RingBuffer::space() const { return capacity() - size(); }
+
+size_t Player::RingBuffer::write(const Byte *data, size_t len) {
+  auto head = head_.load(std::memory_order_relaxed);
+  auto tail = tail_.load(std::memory_order_acquire);
+  len = std::min(len, capacity_ - (head - tail));
+  if (len < 1) {
+    return 0;
+  }
+  auto pos = head % capacity_;
+  auto first = std::min(len, capacity_ - pos);
+  memcpy(data_ + pos, data, first);
+  memcpy(data_, data + first, len - first);
+  head_.store(head + len, std::memory_order_release);
+  return len;
+}
+
+size_t Player::RingBuffer::read(Byte *data, size_t len) {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  auto head = head_.load(std::memory_order_acquire);
+  len = std::min(len, head - tail);
+  if (len < 1) {
+    return 0;
+  }
+  auto pos = tail % capacity_;
+  auto first = std::min(len, capacity_ - pos);
+  memcpy(data, data_ + pos, first);
+  memcpy(data + first, data_, len - first);
+  tail_.store(tail + len, std::memory_order_release);
+  cond_.notify_one();
+  return len;
+}
+
+void Player::RingBuffer::wait(const std::atomic<bool> &running) {
+  // the consumer never takes the lock, so a notify can slip past us; the timeout bounds that
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (running) {
+    cond_.wait_for(lock, std::chrono::milliseconds(5));
+  }
+}
+
+bool Player::RingBuffer::waitWritable(size_t len, const std::atomic<bool> &running) {
+  len = std::min(len, capacity());
+  while (running && space() < len) {
+    wait(running);
+  }
+  return running;
+}
+
+bool Player::RingBuffer::waitEmpty(const std::atomic<bool> &running) {
+  while (running && size() > 0) {
+    wait(running);
+  }
+  return running;
+}
@@ -0,0 +1,133 @@
+#include "Utils/scaler.h"
+
+#include <algorithm>
+#include <atomic>
+
+// 每个切片至少输出的行数，再小线程开销就不值得了
+#define SCALER_MIN_ROWS 128
+
+Player::Scaler::~Scaler() { clear(); }
+
+void Player::Scaler::clear() {
+  for (auto ctx : contexts_) {
+    sws_freeContext(ctx);
+  }
+  contexts_.clear();
+}
+
+bool Player::Scaler::configure(const AVFrame *src, const AVFrame *dst) {
+  auto srcFormat = (AVPixelFormat)src->format;
+  auto dstFormat = (AVPixelFormat)dst->format;
+  if (!contexts_.empty() && src->width == srcWidth_ && src->height == srcHeight_ &&
+      srcFormat == srcFormat_ && dst->width == dstWidth_ && dst->height == dstHeight_ &&
+      dstFormat == dstFormat_) {
+    return true;
+  }
+  clear();
+  size_t slices = 1;
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+  auto threads = threads_ ? threads_ : std::max(1u, std::thread::hardware_concurrency());
+  slices = std::max<size_t>(1, std::min<size_t>(threads, dst->height / SCALER_MIN_ROWS));
+#endif
+  for (size_t i = 0; i < slices; ++i) {
+    auto ctx = sws_getContext(src->width, src->height, srcFormat, dst->width, dst->height,
+                              dstFormat, flags_, nullptr, nullptr, nullptr);
+    if (!ctx) {
+      av_log(nullptr, AV_LOG_ERROR, "%s\n", "Failed to call sws_getContext");
+      clear();
+      return false;
+    }
+    contexts_.push_back(ctx);
+  }
+  sliceRows_ = dst->height;
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+  if (slices > 1) {
+    // every slice but the last has to start and end on the alignment swscale asks for
+    int alignment = (int)sws_receive_slice_alignment(contexts_[0]);
+    int rows = (dst->height + (int)slices - 1) / (int)slices;
+    sliceRows_ = (rows + alignment - 1) / alignment * alignment;
+    slices = (dst->height + sliceRows_ - 1) / sliceRows_;
+    while (contexts_.size() > slices) {
+      sws_freeContext(contexts_.back());
+      contexts_.pop_back();
+    }
+    if (slices > 1 && !pool_) {
+      pool_ = std::make_unique<ThreadPool>(threads_);
+    }
+  }
+#endif
+  srcWidth_ = src->width;
+  srcHeight_ = src->height;
+  srcFormat_ = srcFormat;
+  dstWidth_ = dst->width;
+  dstHeight_ = dst->height;
+  dstFormat_ = dstFormat;
+  av_log(nullptr, AV_LOG_INFO, "scaler %dx%d %s -> %dx%d %s in %zu slice(s)\n", srcWidth_,
+         srcHeight_, av_get_pix_fmt_name(srcFormat_), dstWidth_, dstHeight_,
+         av_get_pix_fmt_name(dstFormat_), contexts_.size());
+  return true;
+}
+
+bool Player::Scaler::scale(const AVFrame *src, AVFrame *dst) {
+  if (!configure(src, dst)) {
+    return false;
+  }
+  if (contexts_.size() > 1) {
+    return scaleSlices(src, dst);
+  }
+  int ret = sws_scale(contexts_[0], src->data, src->linesize, 0, src->height, dst->data,
+                      dst->linesize);
+  if (ret < 0) {
+    log_error(ret);
+    return false;
+  }
+  return true;
+}
+
+bool Player::Scaler::scaleSlices(const AVFrame *src, AVFrame *dst) {
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+  size_t started = 0;
+  std::atomic<bool> ok{true};
+  // every context sees the whole source and produces only its own rows
+  for (auto ctx : contexts_) {
+    int ret = sws_frame_start(ctx, dst, src);
+    if (ret >= 0) {
+      started++;
+      ret = sws_send_slice(ctx, 0, src->height);
+    }
+    if (ret < 0) {
+      log_error(ret);
+      ok = false;
+      break;
+    }
+  }
+
+  if (ok) {
+    auto receive = [this, &ok](size_t slice) {
+      int start = (int)slice * sliceRows_;
+      int rows = std::min(sliceRows_, dstHeight_ - start);
+      int ret = sws_receive_slice(contexts_[slice], start, rows);
+      if (ret < 0) {
+        log_error(ret);
+        ok = false;
+      }
+    };
+    std::vector<std::future<void>> pending;
+    for (size_t i = 1; i < contexts_.size(); ++i) {
+      pending.push_back(pool_->submit([&receive, i] { receive(i); }));
+    }
+    // the first slice on this thread instead of waiting idle
+    receive(0);
+    for (auto &future : pending) {
+      future.wait();
+    }
+  }
+
+  for (size_t i = 0; i < started; ++i) {
+    sws_frame_end(contexts_[i]);
+  }
+  return ok;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,166 @@
+#include "Utils/stats.h"
+
+#include <algorithm>
+
+int Player::Histogram::bucket(uint64_t value) const {
+  if (width_) {
+    return (int)std::min<uint64_t>(value / width_, Buckets - 1);
+  }
+  int index = 0;
+  while (value > 1 && index < Buckets - 1) {
+    value >>= 1;
+    index++;
+  }
+  return index;
+}
+
+uint64_t Player::Histogram::upperBound(int bucket) const {
+  return width_ ? (bucket + 1) * width_ : (uint64_t)2 << bucket;
+}
+
+void Player::Histogram::add(uint64_t value) {
+  buckets_[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  auto max = max_.load(std::memory_order_relaxed);
+  while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+void Player::Histogram::reset() {
+  for (auto &bucket : buckets_) {
+    bucket = 0;
+  }
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+double Player::Histogram::mean() const {
+  auto count = this->count();
+  return count ? (double)sum_.load(std::memory_order_relaxed) / (double)count : 0;
+}
+
+uint64_t Player::Histogram::percentile(double p) const {
+  auto target = (uint64_t)(p * (double)count());
+  uint64_t seen = 0;
+  for (int i = 0; i < Buckets; ++i) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen > target) {
+      return std::min(upperBound(i), max());
+    }
+  }
+  return max();
+}
+
+void Player::Histogram::dump(const char *name, const char *unit, int level) const {
+  av_log(nullptr, level, "%-9s n=%-8llu mean=%.1f p50<=%llu p99<=%llu max=%llu %s\n", name,
+         (unsigned long long)count(), mean(), (unsigned long long)percentile(0.5),
+         (unsigned long long)percentile(0.99), (unsigned long long)max(), unit);
+}
+
+void Player::AudioStats::reset() {
+  callbacks = 0;
+  underruns = 0;
+  duration.reset();
+  jitter.reset();
+  fill.reset();
+}
+
+void Player::AudioStats::dump() const {
+  av_log(nullptr, AV_LOG_INFO, "callbacks=%llu underruns=%llu\n",
+         (unsigned long long)callbacks.load(), (unsigned long long)underruns.load());
+  duration.dump("callback", "us");
+  jitter.dump("jitter", "us");
+  fill.dump("fill", "%");
+}
+
+void Player::CaptureStats::reset() {
+  packets = 0;
+  drops = 0;
+  droppedBytes = 0;
+  queuedBytes = 0;
+  highWater = 0;
+  write.reset();
+  depth.reset();
+}
+
+void Player::CaptureStats::dump() const {
+  av_log(nullptr, AV_LOG_INFO, "packets=%llu drops=%llu (%llu bytes) high-water=%llu bytes\n",
+         (unsigned long long)packets.load(), (unsigned long long)drops.load(),
+         (unsigned long long)droppedBytes.load(), (unsigned long long)highWater.load());
+  write.dump("write", "us");
+  depth.dump("depth", "packets");
+}
+
+void Player::IOStats::reset() {
+  bytesRead = 0;
+  bytesWritten = 0;
+  requests = 0;
+  stalled = 0;
+  opened = av_gettime_relative();
+  latency.reset();
+}
+
+void Player::IOStats::dump(const char *name, int level) const {
+  auto elapsed = std::max<int64_t>(av_gettime_relative() - opened, 1);
+  auto bytes = bytesRead.load() + bytesWritten.load();
+  av_log(nullptr, level,
+         "%s: read=%llu written=%llu bytes in %llu requests, %.1f MB/s, %.1f%% waiting on I/O\n",
+         name, (unsigned long long)bytesRead.load(), (unsigned long long)bytesWritten.load(),
+         (unsigned long long)requests.load(), (double)bytes / (double)elapsed,
+         100.0 * (double)stalled.load() / (double)elapsed);
+  latency.dump("latency", "us", level);
+}
+
+void Player::VideoStats::reset() {
+  shown = 0;
+  dropped = 0;
+  late = 0;
+  lateness.reset();
+}
+
+void Player::VideoStats::dump() const {
+  av_log(nullptr, AV_LOG_INFO, "frames shown=%llu dropped=%llu late=%llu\n",
+         (unsigned long long)shown.load(), (unsigned long long)dropped.load(),
+         (unsigned long long)late.load());
+  lateness.dump("lateness", "us");
+}
+
+void Player::PlaybackStats::reset() {
+  video.reset();
+  drift.reset();
+  audioPackets.reset();
+  videoPackets.reset();
+  audioFrames.reset();
+  videoFrames.reset();
+}
+
+void Player::PlaybackStats::dump() const {
+  video.dump();
+  drift.dump("a/v drift", "us");
+  audioPackets.dump("audio pkt", "packets");
+  videoPackets.dump("video pkt", "packets");
+  audioFrames.dump("audio frm", "frames");
+  videoFrames.dump("video frm", "frames");
+}
+
+uint64_t Player::PoolStats::avoided() const {
+  auto requests = this->requests.load();
+  return requests - std::min(allocated.load(), requests);
+}
+
+void Player::PoolStats::reset() {
+  requests = 0;
+  allocated = 0;
+  recycled = 0;
+  discarded = 0;
+}
+
+void Player::PoolStats::dump(const char *name) const {
+  av_log(nullptr, AV_LOG_INFO,
+         "%s: requests=%llu allocated=%llu avoided=%llu recycled=%llu discarded=%llu\n", name,
+         (unsigned long long)requests.load(), (unsigned long long)allocated.load(),
+         (unsigned long long)avoided(), (unsigned long long)recycled.load(),
+         (unsigned long long)discarded.load());
+}
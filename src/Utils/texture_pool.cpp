@@ -0,0 +1,49 @@
+#include "Utils/texture_pool.h"
+
+Player::TexturePool::~TexturePool() { clear(); }
+
+SDL_Texture *Player::TexturePool::acquire(uint32_t format, int width, int height, int access) {
+  stats_.requests++;
+  auto it = textures_.find(Key{format, width, height, access});
+  if (it != textures_.end() && !it->second.empty()) {
+    auto texture = it->second.back();
+    it->second.pop_back();
+    return texture;
+  }
+  auto texture = SDL_CreateTexture(renderer_, format, access, width, height);
+  if (!texture) {
+    av_log(nullptr, AV_LOG_ERROR, "%s\n", SDL_GetError());
+    return nullptr;
+  }
+  stats_.allocated++;
+  return texture;
+}
+
+void Player::TexturePool::release(SDL_Texture *texture) {
+  if (!texture) {
+    return;
+  }
+  uint32_t format;
+  int access, width, height;
+  if (SDL_QueryTexture(texture, &format, &access, &width, &height)) {
+    SDL_DestroyTexture(texture);
+    return;
+  }
+  auto &idle = textures_[Key{format, width, height, access}];
+  if (idle.size() >= idle_) {
+    stats_.discarded++;
+    SDL_DestroyTexture(texture);
+    return;
+  }
+  stats_.recycled++;
+  idle.push_back(texture);
+}
+
+void Player::TexturePool::clear() {
+  for (auto &[key, idle] : textures_) {
+    for (auto texture : idle) {
+      SDL_DestroyTexture(texture);
+    }
+  }
+  textures_.clear();
+}
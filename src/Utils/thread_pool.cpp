@@ -0,0 +1,36 @@
+#include "Utils/thread_pool.h"
+
+#include <algorithm>
+
+static size_t threadCount(size_t threads) {
+  return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+Player::ThreadPool::ThreadPool(size_t threads, size_t queued)
+    : tasks_(queued ? queued : threadCount(threads) * 4) {
+  threads = threadCount(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back(&Player::ThreadPool::run, this);
+  }
+}
+
+Player::ThreadPool::~ThreadPool() {
+  tasks_.finish();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+std::future<void> Player::ThreadPool::submit(std::function<void()> task) {
+  std::packaged_task<void()> packaged(std::move(task));
+  auto future = packaged.get_future();
+  tasks_.push(std::move(packaged));
+  return future;
+}
+
+void Player::ThreadPool::run() {
+  std::packaged_task<void()> task;
+  while (tasks_.pop(task)) {
+    task();
+  }
+}
@@ -13,7 +13,8 @@ Player::App::~App() { deinit(); }
 
 void Player::App::init() {
   avdevice_register_all();
-  av_log_set_level(AV_LOG_ERROR);
+  // the recorders and players report their stats at info level
+  av_log_set_level(AV_LOG_INFO);
   if (window_ == nullptr) {
     window_ = new Window();
   }
@@ -26,13 +27,24 @@ void Player::App::init() {
     recorder_ = new Recorder();
   }
 
+  if (!mixer_) {
+    mixer_ = new Mixer();
+  }
+
   if (!audio_) {
-    recorder_->openDevice(AUDIO_DEVICE_NAME);
+    recorder_->openDevice(AVMEDIA_TYPE_AUDIO);
     audio_ = new Audio(recorder_->context());
+    audio_->setMixer(mixer_);
     recorder_->closeDevice();
   }
   renderer_ = window_->init();
   running_ = (renderer() != nullptr);
+  if (running_ && !textures_) {
+    textures_ = new TexturePool(renderer());
+  }
+  if (running_ && !scaler_) {
+    scaler_ = new Scaler();
+  }
 }
 
 void Player::App::setWindow(Window *window) { window_ = window; }
@@ -43,7 +55,13 @@ void Player::App::render() {
 }
 
 void Player::App::handleEvents() {
-  if (SDL_WaitEvent(&event_)) {
+  // a playing clip wakes the loop up for its next frame
+  auto timeout = video_ ? video_->update() : -1;
+  if (player_ && player_->playing()) {
+    auto next = player_->update();
+    timeout = timeout < 0 ? next : next < 0 ? timeout : std::min(timeout, next);
+  }
+  if (timeout >= 0 ? SDL_WaitEventTimeout(&event_, timeout) : SDL_WaitEvent(&event_)) {
     if (SDL_QUIT == event_.type) {
       running_ = false;
     } else if (SDL_KEYDOWN == event_.type) {
@@ -76,11 +94,36 @@ void Player::App::handleKeydown() {
       recorder_->recordVideo();
     }
     break;
+  case SDLK_v:
+    if (recorder_) {
+      recorder_->setFilename("../resources/out.mkv");
+      recorder_->recordVideo();
+    }
+    break;
+  case SDLK_m:
+    if (recorder_) {
+      recorder_->setFilename("../resources/out_av.mkv");
+      recorder_->recordAV();
+    }
+    break;
   case SDLK_h:
     if (recorder_) {
-      recorder_->resample();
-      Player::Recorder::pcm2AAC();
-      Player::Audio::decodeAAC();
+      recorder_->pipeline();
+    }
+    break;
+  case SDLK_g:
+    if (audio_) {
+      audio_->setFilename("../resources/resample.aac");
+      audio_->playAAC();
+    }
+    break;
+  case SDLK_p:
+    if (audio_) {
+      if (!audio_->playing()) {
+        audio_->enqueue("../resources/out.wav");
+        audio_->enqueue("../resources/out.pcm");
+      }
+      audio_->playQueue();
     }
     break;
   case SDLK_l:
@@ -89,26 +132,67 @@ void Player::App::handleKeydown() {
       audio_->playWAV();
     }
     break;
+  case SDLK_0:
+  case SDLK_1:
+  case SDLK_2:
+  case SDLK_3:
+  case SDLK_4:
+  case SDLK_5:
+  case SDLK_6:
+  case SDLK_7:
+  case SDLK_8:
+  case SDLK_9:
+    // jump that many seconds into what is playing
+    if (audio_ && audio_->playing()) {
+      audio_->seek((event_.key.keysym.sym - SDLK_0) * 1000);
+    }
+    break;
   case SDLK_SPACE:
     if (recorder_) {
       recorder_->setFilename("../resources/out.wav");
       recorder_->recordWAV();
     }
     break;
+  case SDLK_r:
+    if (recorder_) {
+      recorder_->setFilename("../resources/out.aac");
+      recorder_->recordAAC();
+    }
+    break;
   case SDLK_a:
     if (renderer()) {
-      Image image(renderer());
+      Image image(renderer(), textures_);
       image.load("../resources/image.bmp");
       image.render();
     }
     break;
   case SDLK_b:
     if (renderer()) {
-      Image image(renderer());
+      Image image(renderer(), textures_, scaler_);
       image.load("../resources/output.yuv", 1728, 2160);
       image.render();
     }
     break;
+  case SDLK_y:
+    if (renderer()) {
+      if (!video_) {
+        video_ = new RawVideo(renderer());
+      }
+      video_->open("../resources/out.yuv");
+    }
+    break;
+  case SDLK_o:
+    if (renderer()) {
+      if (!player_) {
+        player_ = new MediaPlayer(renderer(), mixer_);
+      }
+      if (player_->playing()) {
+        player_->close();
+      } else {
+        player_->open("../resources/video.mp4");
+      }
+    }
+    break;
   default:
     break;
   }
@@ -138,8 +222,17 @@ void Player::App::deinit() {
   if (joystick_ != nullptr) {
     SDL_JoystickClose(joystick_);
   }
+  deletePtr(&player_);
+  if (textures_) {
+    textures_->stats().dump("textures");
+  }
+  // the pool's textures go before the renderer does
+  deletePtr(&textures_);
+  deletePtr(&scaler_);
+  deletePtr(&video_);
   deletePtr(&window_);
   deletePtr(&audio_);
+  deletePtr(&mixer_);
   deletePtr(&recorder_);
   SDL_DestroyRenderer(renderer_);
 
@@ -148,7 +241,7 @@ void Player::App::deinit() {
 
 void Player::App::handleMouseClick() {
   auto btn = event_.button;
-  Image image(renderer());
+  Image image(renderer(), textures_);
   image.createTexture();
   SDL_SetRenderTarget(renderer(), nullptr);
   int x = btn.x - (image.width() >> 1);
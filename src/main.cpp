@@ -1,6 +1,150 @@
+#include "Core/sink.h"
+#include "Core/transcoder.h"
+#include "Utils/color_kernels.h"
+#include "Utils/mix_kernels.h"
 #include "app.h"
 
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// player --bench <file> [null | realtime | <output.pcm>]
+static int bench(const std::string &filename, const std::string &sink) {
+  av_log_set_level(AV_LOG_INFO);
+  std::unique_ptr<Player::NullSink> output;
+  if (sink.empty() || sink == "null") {
+    output = std::make_unique<Player::NullSink>();
+  } else if (sink == "realtime") {
+    output = std::make_unique<Player::NullSink>(true);
+  } else {
+    output = std::make_unique<Player::FileSink>(sink);
+  }
+  Player::Mixer mixer(output.get());
+  Player::Audio audio(filename);
+  audio.setMixer(&mixer);
+
+  auto begin = std::chrono::steady_clock::now();
+  auto extension = fs::path(filename).extension().string();
+  if (extension == ".wav") {
+    audio.playWAV();
+  } else if (extension == ".aac") {
+    audio.playAAC();
+  } else {
+    audio.play();
+  }
+  while (audio.playing()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+  auto &spec = mixer.spec();
+  if (spec.freq < 1) {
+    return 1;
+  }
+  auto played = output->played();
+  av_log(nullptr, AV_LOG_INFO, "mix kernels: %s\n", Player::mixKernels().name);
+  av_log(nullptr, AV_LOG_INFO, "played %.2fs of audio in %.2fs (%.1fx realtime)\n", played,
+         elapsed.count(), elapsed.count() > 0 ? played / elapsed.count() : 0);
+  return 0;
+}
+
+// player --batch <manifest> [threads]
+static int batch(const std::string &manifest, int threads) {
+  av_log_set_level(AV_LOG_INFO);
+  Player::Transcoder transcoder(threads > 0 ? threads : 0);
+  if (!transcoder.load(manifest)) {
+    return 1;
+  }
+  return transcoder.run() ? 0 : 1;
+}
+
+// time `iterations` runs of `convert` in megapixels per second
+template <typename F> static double throughput(int width, int height, int iterations, F convert) {
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    convert();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+  return elapsed.count() > 0 ? (double)width * height * iterations / elapsed.count() / 1e6 : 0;
+}
+
+static AVFrame *benchFrame(AVPixelFormat format, int width, int height) {
+  auto frame = av_frame_alloc();
+  frame->format = format;
+  frame->width = width;
+  frame->height = height;
+  if (av_frame_get_buffer(frame, 0) < 0) {
+    av_frame_free(&frame);
+    return nullptr;
+  }
+  // something other than a flat picture
+  for (int p = 0; p < AV_NUM_DATA_POINTERS && frame->buf[p]; ++p) {
+    for (size_t i = 0; i < frame->buf[p]->size; ++i) {
+      frame->buf[p]->data[i] = (Byte)(i * 7 + p * 31);
+    }
+  }
+  return frame;
+}
+
+// player --bench-color [iterations]
+static int colorBench(int iterations) {
+  av_log_set_level(AV_LOG_INFO);
+  struct Case {
+    AVPixelFormat src;
+    AVPixelFormat dst;
+  };
+  const Case cases[] = {{AV_PIX_FMT_YUYV422, AV_PIX_FMT_YUV420P},
+                        {AV_PIX_FMT_YUYV422, AV_PIX_FMT_NV12},
+                        {AV_PIX_FMT_YUV420P, AV_PIX_FMT_BGRA}};
+  const int sizes[][2] = {{640, 480}, {1920, 1080}};
+  auto &kernels = Player::colorKernels();
+  auto &scalar = Player::scalarColorKernels();
+  av_log(nullptr, AV_LOG_INFO, "color kernels: %s, %d iterations\n", kernels.name, iterations);
+  for (auto &size : sizes) {
+    int width = size[0], height = size[1];
+    for (auto &c : cases) {
+      auto src = benchFrame(c.src, width, height);
+      auto dst = benchFrame(c.dst, width, height);
+      auto sws = sws_getContext(width, height, c.src, width, height, c.dst, SWS_BILINEAR, nullptr,
+                                nullptr, nullptr);
+      if (!src || !dst || !sws) {
+        av_frame_free(&src);
+        av_frame_free(&dst);
+        sws_freeContext(sws);
+        return 1;
+      }
+      auto simd = throughput(width, height, iterations, [&] { Player::convertFrame(src, dst); });
+      auto plain = throughput(width, height, iterations,
+                              [&] { Player::convertFrame(src, dst, scalar); });
+      auto swscale = throughput(width, height, iterations, [&] {
+        sws_scale(sws, src->data, src->linesize, 0, height, dst->data, dst->linesize);
+      });
+      av_log(nullptr, AV_LOG_INFO,
+             "%4dx%-4d %-8s -> %-8s %s %8.1f  scalar %8.1f  sws_scale %8.1f Mpix/s\n", width,
+             height, av_get_pix_fmt_name(c.src), av_get_pix_fmt_name(c.dst), kernels.name, simd,
+             plain, swscale);
+      sws_freeContext(sws);
+      av_frame_free(&src);
+      av_frame_free(&dst);
+    }
+  }
+  return 0;
+}
+
 int main(int argc, char **argv) {
+  if (argc > 2 && std::string(argv[1]) == "--bench") {
+    return bench(argv[2], argc > 3 ? argv[3] : "");
+  }
+  if (argc > 1 && std::string(argv[1]) == "--bench-color") {
+    return colorBench(argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 200);
+  }
+  if (argc > 2 && std::string(argv[1]) == "--batch") {
+    return batch(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+  }
+
   Player::App app;
   app.render();
 